@@ -11,35 +11,64 @@
  *	\date	27/03/2019
  */
 
+#include <stddef.h>
 #include "S32K144.h"
+#include "S32K144_features.h"
+#include "s32_core_cm4.h"
 #include "CAN.h"
+#include "CAN_Critical.h"
+#include "CAN_Defer.h"
 
 #define MESSAGES_BUFF		(32)			/*Number of MB for CAN0*/
 #define MESSAGES_BUFF_CAN12	(16)			/*Number of MB for CAN1 y CAN2*/
 #define WORDS_PER_MB		(4)				/*Words per Messages Buffer*/
 #define RAM_LENGTH			(128)			/*Length of the RAM*/
 #define MAX_DATA			(2)				/*Maximum of words with data*/
-#define MB_FILT				(16)			/*Messages Buffer filtered*/
 #define CHECK_ID			(0xFFFFFFFF)	/*Check all IDs for MB*/
 #define CHECK_ALL_ID		(0x1FFFFFFF)	/*Global acceptance mask*/
 #define RX_MB4				(16)			/*Message Buffer 4 for RX*/
 #define ENABLE_RX			(0x04000000)	/*Code field of the Control and Status*/
 #define RX_ID_WORD			(0x14440000)	/*Word with ID for RX*/
-#define CANFD_NOT_USED		(0x0000001F)	/*Prior equal to zero*/
-#define CLEAN_MB0			(0x00000001)	/*Clean the flag of MB0*/
-#define TX_MB0				(0)				/*Message Buffer 0 for TX*/
+#define MCR_CONFIG_MASK		(CAN_MCR_MAXMB_MASK | CAN_MCR_FDEN_MASK | CAN_MCR_IRMQ_MASK | CAN_MCR_AEN_MASK)
+#define SHIFT_STD_MASK		(18)			/*Shift of the standard ID in the RXIMR*/
 #define DISABLE_RX			(0x00000000)	/*Disable the RX*/
 
 #define TX_ID_WORD			(0x15540000)	/*Word with ID for TX*/
 #define DLC_LENGTH			(8)				/*Length of DLC in Bytes*/
 #define CODE_FIELD_TX		(0x0C000000)	/*Code to enable the transmission of MB*/
 #define SRR_TX				(0x400000)		/*Set the TX frame*/
+#define SHIFT_STD_ID		(18)			/*Shift of the standard ID in the ID word*/
+#define CODE_MASK			(0x0F000000)	/*Code field of the Control and Status*/
+#define CODE_TX_INACTIVE	(0x08000000)	/*Code of a TX MB not transmitting*/
+#define CODE_TX_ABORT		(0x09000000)	/*Code to abort the transmission of MB*/
+#define CODE_RX_INACTIVE	(0x00000000)	/*Code of a RX MB not receiving*/
+#define CODE_RX_EMPTY		(0x04000000)	/*Code of a RX MB waiting for a frame*/
+#define CODE_RX_RANSWER		(0x0A000000)	/*Code of a MB answering remote requests*/
+#define CODE_TX_TANSWER		(0x0E000000)	/*Code of a MB sending the answer to a remote request*/
+#define TX_POOL_FIRST		(CAN_TX_POOL_FIRST)	/*First Message Buffer of the TX pool*/
+#define TX_POOL_SIZE		(CAN_TX_POOL_SIZE)	/*Message Buffers in the TX pool*/
+#define TX_POOL_MASK		(0x00000F00)	/*Flags of the TX pool*/
+#define TX_ERRORS			(CAN_ESR1_ACKERR_MASK | CAN_ESR1_BIT0ERR_MASK | CAN_ESR1_BIT1ERR_MASK)
+#define TIMER_MASK			(0x0000FFFF)	/*Bits of the free running timer*/
+#define TIMER_WRAP			(0x00010000)	/*Period of the free running timer*/
+#define TX_CONFIRM_SIZE		(16)			/*Confirmations kept per port, power of 2*/
+#define RX_RING_SIZE		(32)			/*Queued frames kept per port, power of 2*/
+#define MB_IRQ_SPLIT		(16)			/*First MB of the second MB interrupt of CAN0*/
+#define FIFO_MB_MASK		(0x000000FF)	/*MBs taken by the RX FIFO and 8 filters*/
+#define FIFO_AVAILABLE		(0x00000020)	/*Flag of a frame available in the FIFO*/
+#define FIFO_WARNING		(0x00000040)	/*Flag of the FIFO filled up to the watermark*/
+#define FIFO_OVERFLOW		(0x00000080)	/*Flag of a frame lost by the FIFO*/
+#define FIFO_FILTER_MB		(6)				/*First MB of the FIFO filter table*/
+#define FIFO_FILTERS		(8)				/*Filters of the table with RFFN = 0*/
+#define FIFO_ACCEPT_ALL		(0x00000000)	/*Mask of the FIFO filters, every ID*/
+#define FIFO_DRAIN			(0xFFFFFFFF)	/*Frames moved by the FIFO interrupt, all*/
+#define HOT_TABLE_SIZE		(16)			/*IDs profiled per port*/
+#define HOT_NO_ID			(0xFFFFFFFF)	/*Entry of the profile without ID*/
+#define DEFER_RING_SIZE		(32)			/*Events kept per port for the bottom half, power of 2*/
 
 #define SHIFT_CODE_RX		(24)			/*Shift to obtain the code of RX*/
-#define CODE_MASK_RX		(0x07000000)	/*Mask to obtain the code of RX*/
-#define RX_DATA_MB4			(18)			/*Position of data in MB4*/
+#define CODE_BUSY_RX		(0x01000000)	/*The controller is moving a frame into the MB*/
 #define TIME_STAMP_RX		(0x000FFFF)		/*Mask to obtain the time stamp*/
-#define MB4_CLEAN_FLAG		(0x00000010)	/*Mask to clean the MB4 flag*/
 #define SYNC_SEGMENT		(1)				/*Synchronization Segment*/
 #define SHIFT_PSEG1			(19)			/*Shift to Phase Segment 1*/
 #define SHIFT_PSEG2			(16)			/*Shift to Phase Segment 2*/
@@ -47,8 +76,157 @@
 #define SHIFT_SMP			(7)				/*Shift to Sampling bit*/
 #define SHIFT_PRESDIV		(24)			/*Shift to Prescaler divisor*/
 
+#define MB_WORD(mb)			((mb) * WORDS_PER_MB)	/*First word of a Message Buffer*/
+
+/*With CAN_FIXED_PORT every lookup of the port is a constant and the other ports are compiled out*/
+#ifdef CAN_FIXED_PORT
+#define CAN_PORT_NUM		(1)
+#define CAN_INDEX(portCAN)	((void)(portCAN), 0)
+#define CAN_INST(portCAN)	((void)(portCAN), &CAN_Instance[CAN_FIXED_PORT])
+#define CAN_PORT_USED(n)	((n) == CAN_FIXED_PORT)
+#else
+#define CAN_PORT_NUM		(CAN_INSTANCE_COUNT)
+#define CAN_INDEX(portCAN)	(portCAN)
+#define CAN_INST(portCAN)	(&CAN_Instance[CAN_INDEX(portCAN)])
+#define CAN_PORT_USED(n)	(1)
+#endif
+#define MB_USED_INIT		(TX_POOL_MASK | (1UL << (RX_MB4 / WORDS_PER_MB)))	/*MBs of the driver*/
+
 Rx_t	rx;		/*Structure of Rx*/
 
+/*Hardware of a port*/
+typedef struct
+{
+	CAN_Type	*base;			/*Registers of the port*/
+	uint8_t		mbCount;		/*Message buffers of the port*/
+	IRQn_Type	mbIrq;			/*IRQ of MB0-15*/
+	IRQn_Type	mbIrqHigh;		/*IRQ of MB16-31, only in CAN0*/
+	IRQn_Type	errorIrq;		/*IRQ of bus errors*/
+	uint32_t	pccIndex;		/*Clock gate of the port*/
+} CAN_Instance_t;
+
+static const CAN_Instance_t CAN_Instance[CAN_INSTANCE_COUNT] =
+{
+	{CAN0, FEATURE_CAN0_MAX_MB_NUM, CAN0_ORed_0_15_MB_IRQn, CAN0_ORed_16_31_MB_IRQn, CAN0_Error_IRQn, PCC_FlexCAN0_INDEX},
+	{CAN1, FEATURE_CAN1_MAX_MB_NUM, CAN1_ORed_0_15_MB_IRQn, NotAvail_IRQn, CAN1_Error_IRQn, PCC_FlexCAN1_INDEX},
+	{CAN2, FEATURE_CAN2_MAX_MB_NUM, CAN2_ORed_0_15_MB_IRQn, NotAvail_IRQn, CAN2_Error_IRQn, PCC_FlexCAN2_INDEX}
+};
+
+static uint32_t mbUsed[CAN_PORT_NUM];	/*MBs taken by the driver or the application*/
+
+static uint32_t rxOverrun[CAN_PORT_NUM][FEATURE_CAN_MAX_MB_NUM];	/*Frames lost per MB*/
+static uint32_t rxPortOverrun[CAN_PORT_NUM];						/*Frames lost per port*/
+static CAN_OverrunCallback_t rxOverrunCallback[CAN_PORT_NUM];		/*NULL only counts*/
+static uint32_t rxLatestMask[CAN_PORT_NUM];						/*MBs of RX_LATEST IDs*/
+static uint32_t rxSignalMask[CAN_PORT_NUM];						/*MBs of RX_SIGNAL IDs*/
+
+/*Newest frame of a RX_SIGNAL MB, odd sequence while it is written*/
+typedef struct
+{
+	volatile uint32_t	seq;
+	Rx_t				value;
+} Signal_t;
+
+static Signal_t rxSignal[CAN_PORT_NUM][FEATURE_CAN_MAX_MB_NUM];	/*Signal store*/
+
+/*ID profiled by the adaptive mode*/
+typedef struct
+{
+	uint32_t	ID;		/*Standard identifier*/
+	uint32_t	count;	/*Frames since the previous service, halved on every service*/
+	uint8_t		mb;		/*Dedicated MB or CAN_NO_MB*/
+} HotID_t;
+
+static HotID_t rxHot[CAN_PORT_NUM][HOT_TABLE_SIZE];	/*Most frequent IDs*/
+static uint8_t rxHotLimit[CAN_PORT_NUM];				/*MBs for promoted IDs*/
+static uint8_t rxAdaptive[CAN_PORT_NUM];				/*1 when the FIFO is enabled*/
+static uint8_t rxCoalesce[CAN_PORT_NUM];				/*1 when the FIFO interrupts at the watermark*/
+static CAN_RxIrqStats_t rxIrqStats[CAN_PORT_NUM];		/*Interrupts and polls of the FIFO*/
+static CAN_RxNapi_t rxNapi[CAN_PORT_NUM];				/*burstFrames = 0 when disabled*/
+static CAN_RxNapiStats_t rxNapiStats[CAN_PORT_NUM];	/*Switches and time per mode*/
+static uint8_t rxNapiPolling[CAN_PORT_NUM];			/*1 while the FIFO interrupt is masked*/
+static uint32_t rxNapiSince[CAN_PORT_NUM];				/*Time of the last switch*/
+static uint32_t rxNapiWindow[CAN_PORT_NUM];			/*Start of the burst window*/
+static uint32_t rxNapiFrames[CAN_PORT_NUM];			/*Frames in the burst window*/
+
+static Rx_t rxRing[CAN_PORT_NUM][RX_RING_SIZE];		/*Queued frames*/
+static volatile uint32_t rxRingHead[CAN_PORT_NUM];	/*Written by the RX interrupt*/
+static volatile uint32_t rxRingTail[CAN_PORT_NUM];	/*Written by the reader*/
+static uint32_t rxRingLost[CAN_PORT_NUM];				/*Frames of a full ring*/
+static CAN_RxHook_t rxHook[CAN_PORT_NUM];				/*NULL queues every frame*/
+static CAN_BusMonitor_t busMonitor[CAN_PORT_NUM];		/*Sees every frame received or sent*/
+
+static volatile CAN_TxStatus_t txStatus[CAN_PORT_NUM][TX_POOL_SIZE];	/*Status of each TX MB*/
+static CAN_TxStatus_t txAbortReason[CAN_PORT_NUM][TX_POOL_SIZE];		/*Status reported after abort*/
+static CAN_TxMode_t txMode[CAN_PORT_NUM][TX_POOL_SIZE];				/*Retransmission policy*/
+static uint32_t txDeadline[CAN_PORT_NUM][TX_POOL_SIZE];				/*0 when there is no deadline*/
+static uint32_t txTag[CAN_PORT_NUM][TX_POOL_SIZE];					/*User tag of each frame*/
+static uint32_t txTime[CAN_PORT_NUM][TX_POOL_SIZE];					/*Time the last frame was sent*/
+static CAN_TxCallback_t txCallback[CAN_PORT_NUM];						/*NULL when polled*/
+static CAN_TxAdmit_t txAdmit[CAN_PORT_NUM];							/*NULL sends every frame*/
+static CAN_TxRefill_t txRefill[CAN_PORT_NUM];						/*NULL leaves the free MBs empty*/
+static CAN_TxDone_t txDone[CAN_PORT_NUM][TX_POOL_SIZE];				/*Completion of CAN_SendAsync*/
+static void *txContext[CAN_PORT_NUM][TX_POOL_SIZE];				/*Context given to txDone*/
+static uint8_t txRemoteWait[CAN_PORT_NUM][TX_POOL_SIZE];			/*1 while a remote request waits for its answer*/
+static uint32_t txRemoteStamp[CAN_PORT_NUM][TX_POOL_SIZE];			/*Time stamp of the remote request sent*/
+static uint8_t txAsync[CAN_PORT_NUM];								/*1 once CAN_SendAsync was used*/
+static CAN_TxDoneStats_t txDoneStats[CAN_PORT_NUM];				/*Cost of the completions*/
+
+static CAN_TxConfirm_t txConfirm[CAN_PORT_NUM][TX_CONFIRM_SIZE];	/*Queue of confirmations*/
+static volatile uint32_t txConfirmHead[CAN_PORT_NUM];				/*Written by the TX path*/
+static volatile uint32_t txConfirmTail[CAN_PORT_NUM];				/*Written by the reader*/
+
+static uint8_t selfRx[CAN_PORT_NUM];		/*1 when the own frames are received*/
+
+/*Work of the interrupts left to the bottom half*/
+typedef enum {DEFER_RX_MONITOR, DEFER_RX_DELIVER, DEFER_TX_MONITOR, DEFER_TX_CALLBACK} DeferKind_t;
+
+typedef struct
+{
+	Rx_t			frame;		/*Frame received or sent*/
+	uint32_t		stamp;		/*Monotonic time of the frame*/
+	DeferKind_t		kind;
+	CAN_TxStatus_t	status;		/*Final status of a TX slot*/
+	uint8_t			slot;		/*TX slot of a callback*/
+	CAN_TxDone_t	done;		/*Completion of the frame of the slot*/
+	void			*context;
+} Deferred_t;
+
+static uint8_t deferId = CAN_DEFER_FULL;				/*Bottom half of the driver*/
+static uint8_t deferOn[CAN_PORT_NUM];					/*1 when the port defers its handlers*/
+static Deferred_t deferRing[CAN_PORT_NUM][DEFER_RING_SIZE];
+static volatile uint32_t deferHead[CAN_PORT_NUM];		/*Written by the interrupts*/
+static volatile uint32_t deferTail[CAN_PORT_NUM];		/*Written by the bottom half*/
+static uint32_t deferLost[CAN_PORT_NUM];				/*Events of a full ring*/
+static uint32_t topHalfMax[CAN_PORT_NUM];				/*Longest MB interrupt in cycles*/
+
+static uint32_t timeHigh[CAN_PORT_NUM];	/*Upper bits of the monotonic time*/
+static uint32_t timeLast[CAN_PORT_NUM];	/*Last value read from the timer*/
+
+/*Freeze the module to write the registers of configuration*/
+static void CAN_EnterFreeze(CAN_Type *base)
+{
+	base->MCR |= CAN_MCR_FRZ_MASK | CAN_MCR_HALT_MASK;
+
+	/*Wait for FRZACK to be frozen*/
+	while (!(base->MCR & CAN_MCR_FRZACK_MASK));
+}
+
+/*Go back to normal mode*/
+static void CAN_ExitFreeze(CAN_Type *base)
+{
+	base->MCR &= ~(CAN_MCR_FRZ_MASK | CAN_MCR_HALT_MASK);
+
+	/*Wait for FRZACK to be unfrozen*/
+	while (base->MCR & CAN_MCR_FRZACK_MASK);
+}
+
+/*Enable an interrupt in the NVIC, under the time triggered transmission*/
+static void CAN_EnableIRQ(IRQn_Type irq)
+{
+	CAN_EnableIRQLevel(irq, CAN_IRQ_PRIORITY);
+}
+
 /*Setup the configurations of the frame between eight options*/
 static void CAN_SetBitTime(PortCAN_t portCAN, clkSource_t clkSource, bitTime_t bitTime, Timing_t timing)
 {
@@ -59,6 +237,7 @@ static void CAN_SetBitTime(PortCAN_t portCAN, clkSource_t clkSource, bitTime_t b
 	uint32_t Pseg2;				/*Phase Segment 2*/
 	uint32_t Proseg;			/*Propagation Segment*/
 	uint32_t Rjw;				/*Resync Jump Width*/
+	CAN_Type *base = CAN_INST(portCAN)->base;	/*Registers of the port*/
 
 	/*Sum all the segments to obtain the total time quantum*/
 	time_quanta = timing.phaseSeg1 + timing.phaseSeg2 + timing.propSeg + SYNC_SEGMENT;
@@ -109,435 +288,1646 @@ static void CAN_SetBitTime(PortCAN_t portCAN, clkSource_t clkSource, bitTime_t b
 	/*Calculate the resync jump width*/
 	Rjw = timing.phaseSeg2 - 1;
 
-	switch(portCAN)
-	{
-	case CAN_0:
-		/*AssigN the Prescaler divisor*/
-		CAN0->CTRL1 |= PresDiv << SHIFT_PRESDIV;
+	/*AssigN the Prescaler divisor*/
+	base->CTRL1 |= PresDiv << SHIFT_PRESDIV;
 
-		/*Assign the Phase Segment 1*/
-		CAN0->CTRL1 |= Pseg1 << SHIFT_PSEG1;
+	/*Assign the Phase Segment 1*/
+	base->CTRL1 |= Pseg1 << SHIFT_PSEG1;
 
-		/*Assign the Phase Segment 2*/
-		CAN0->CTRL1 |= Pseg2 << SHIFT_PSEG2;
+	/*Assign the Phase Segment 2*/
+	base->CTRL1 |= Pseg2 << SHIFT_PSEG2;
 
-		/*Assign the Resyn Jump Width*/
-		CAN0->CTRL1 |= Rjw << SHIFT_RJW;
+	/*Assign the Resyn Jump Width*/
+	base->CTRL1 |= Rjw << SHIFT_RJW;
 
-		/*Assign the Propagation Segment*/
-		CAN0->CTRL1 |= Proseg;
+	/*Assign the Propagation Segment*/
+	base->CTRL1 |= Proseg;
 
-		/*Assign the Sampling bit*/
-		CAN0->CTRL1 |= timing.bitSampling << SHIFT_SMP;
-		break;
-	case CAN_1:
-		/*AssigN the Prescaler divisor*/
-		CAN1->CTRL1 |= PresDiv << SHIFT_PRESDIV;
+	/*Assign the Sampling bit*/
+	base->CTRL1 |= timing.bitSampling << SHIFT_SMP;
+}
+
+/*Setup the CAN with a selectable clock*/
+void CAN_init(PortCAN_t portCAN, const CAN_Config_t* CAN_Config)
+{
+	const CAN_Instance_t *port = CAN_INST(portCAN);
+	CAN_Type *base = port->base;
+	uint32_t counter;
 
-		/*Assign the Phase Segment 1*/
-		CAN1->CTRL1 |= Pseg1 << SHIFT_PSEG1;
+	/*Enable the clock to the port*/
+	PCC->PCCn[port->pccIndex] |= PCC_PCCn_CGC_MASK;
 
-		/*Assign the Phase Segment 2*/
-		CAN1->CTRL1 |= Pseg2 << SHIFT_PSEG2;
+	/*Disable the CAN module before selecting clock*/
+	base->MCR |= CAN_MCR_MDIS_MASK;
 
-		/*Assign the Resyn Jump Width*/
-		CAN1->CTRL1 |= Rjw << SHIFT_RJW;
 
-		/*Assign the Propagation Segment*/
-		CAN1->CTRL1 |= Proseg;
+	if (OSCILLATOR_SRC == CAN_Config->clkSource)
+		/*Choose the Oscillator Clock 8MHz*/
+		base->CTRL1 &= ~CAN_CTRL1_CLKSRC_MASK;
+	else
+		/*Choose the Peripheral Clock*/
+		base->CTRL1 |= CAN_CTRL1_CLKSRC_MASK;
 
-		/*Assign the Sampling bit*/
-		CAN1->CTRL1 |= timing.bitSampling << SHIFT_SMP;
-		break;
-	case CAN_2:
-		/*AssigN the Prescaler divisor*/
-		CAN2->CTRL1 |= PresDiv << SHIFT_PRESDIV;
 
-		/*Assign the Phase Segment 1*/
-		CAN2->CTRL1 |= Pseg1 << SHIFT_PSEG1;
+	/*Enable the CAN module*/
+	base->MCR &= ~CAN_MCR_MDIS_MASK;
 
-		/*Assign the Phase Segment 2*/
-		CAN2->CTRL1 |= Pseg2 << SHIFT_PSEG2;
+	/*Wait for FRZACK to be frozen*/
+	while (!((base->MCR & CAN_MCR_FRZACK_MASK) >> CAN_MCR_FRZACK_SHIFT));
 
-		/*Assign the Resyn Jump Width*/
-		CAN2->CTRL1 |= Rjw << SHIFT_RJW;
+	/*Now we can change the register in CTRL1*/
+	CAN_SetBitTime(portCAN, CAN_Config->clkSource, CAN_Config->bitTime, CAN_Config->timing);
 
-		/*Assign the Propagation Segment*/
-		CAN2->CTRL1 |= Proseg;
+	/*Loopback is enabled*/
+	base->CTRL1 |= CAN_CTRL1_LPB_MASK;
 
-		/*Assign the Sampling bit*/
-		CAN2->CTRL1 |= timing.bitSampling << SHIFT_SMP;
-		break;
-	default:
-		break;
+	/*Remote requests answered by hardware or stored*/
+	if (REMOTE_STORE == CAN_Config->remoteRequest)
+		base->CTRL2 |= CAN_CTRL2_RRS_MASK;
+	else
+		base->CTRL2 &= ~CAN_CTRL2_RRS_MASK;
+
+	/*FIFO is disabled*/
+	base->MCR &= ~ CAN_MCR_RFEN_MASK;
+
+	/*Self reception is enabled or disabled*/
+	if (SELF_RX_OFF == CAN_Config->selfReception)
+		base->MCR |= CAN_MCR_SRXDIS_MASK;
+	else
+		base->MCR &= ~ CAN_MCR_SRXDIS_MASK;
+
+	/*Check all IDs*/
+	for(counter = 0; counter < port->mbCount; counter++)
+		base->RXIMR[counter] = CHECK_ID;
+
+	/*Global acceptance mask to check all the IDs*/
+	base->RXMGMASK = CHECK_ALL_ID;
+
+	/*Disable the RX*/
+	base->RAMn[RX_MB4] = DISABLE_RX;
+
+	/*Assign the standard ID to the next word of MB4*/
+	base->RAMn[RX_MB4 + 1] = TX_ID_WORD;
+
+	/*Enable the RX*/
+	base->RAMn[RX_MB4] = ENABLE_RX;
+
+	/*CAN FD is not used, all the MBs with individual masks and abort of TX MBs*/
+	base->MCR = (base->MCR & ~MCR_CONFIG_MASK) | CAN_MCR_MAXMB(port->mbCount - 1) |
+			CAN_MCR_IRMQ_MASK | CAN_MCR_AEN_MASK;
+
+	/*Leave the freeze mode*/
+	base->MCR &= ~(CAN_MCR_FRZ_MASK | CAN_MCR_HALT_MASK);
+
+	/*Wait for FRZACK to be unfrozen*/
+	while ((base->MCR & CAN_MCR_FRZACK_MASK) >> CAN_MCR_FRZACK_SHIFT);
+
+	/*Wait for CAN Module to be ready*/
+	while ((base->MCR & CAN_MCR_NOTRDY_MASK) >> CAN_MCR_NOTRDY_SHIFT);
+
+	/*Inactivate the TX pool*/
+	for (counter = 0; counter < TX_POOL_SIZE; counter++)
+	{
+		base->RAMn[MB_WORD(TX_POOL_FIRST + counter)] = CODE_TX_INACTIVE;
+		txStatus[CAN_INDEX(portCAN)][counter] = TX_IDLE;
 	}
+
+	selfRx[CAN_INDEX(portCAN)] = (SELF_RX_OFF != CAN_Config->selfReception);
+
+	/*The TX pool and the RX MB belong to the driver*/
+	mbUsed[CAN_INDEX(portCAN)] = MB_USED_INIT;
+	rxLatestMask[CAN_INDEX(portCAN)] = 0;
+	rxSignalMask[CAN_INDEX(portCAN)] = 0;
+	rxAdaptive[CAN_INDEX(portCAN)] = 0;
+	rxCoalesce[CAN_INDEX(portCAN)] = 0;
+	rxNapi[CAN_INDEX(portCAN)].burstFrames = 0;
+	rxNapiPolling[CAN_INDEX(portCAN)] = 0;
+
+	/*The error interrupt aborts the one-shot frames*/
+	CAN_EnableIRQ(port->errorIrq);
 }
 
-/*Setup the CAN with a selectable clock*/
-void CAN_init(PortCAN_t portCAN, const CAN_Config_t* CAN_Config)
+/*Transmit the data through of channel CAN 0 with two data */
+void CAN_Transmitter(PortCAN_t portCAN, uint32_t dataWord1, uint32_t dataWord2)
 {
-	uint32_t counter;
+	CAN_Frame_t frame;
+
+	/* Standard ID 0x555 with the two data words*/
+	frame.ID = TX_ID_WORD >> SHIFT_STD_ID;
+	frame.Length = DLC_LENGTH;
+	frame.Data[0] = dataWord1;
+	frame.Data[1] = dataWord2;
 
-	switch(portCAN)
+	CAN_Send(portCAN, &frame, NULL);
+}
+
+/*Monotonic time of a time stamp taken less than 65536 bit times ago*/
+static uint32_t CAN_ExtendStamp(PortCAN_t portCAN, uint32_t stamp)
+{
+	uint32_t now = CAN_GetTime(portCAN);
+
+	return now - ((now - stamp) & TIMER_MASK);
+}
+
+/*Queue an event for the bottom half of the port, the frame is copied, slot and status are for TX callbacks*/
+static void CAN_Defer(PortCAN_t portCAN, DeferKind_t kind, const Rx_t* frame, uint32_t stamp, uint8_t slot, CAN_TxStatus_t status)
+{
+	Deferred_t *event;
+	uint32_t irqState;
+	uint32_t head;
+
+	/*CAN_Receiver also reports the frames of the RX MB4 out of the interrupts*/
+	irqState = CAN_EnterCritical();
+	head = deferHead[CAN_INDEX(portCAN)];
+	if ((head - deferTail[CAN_INDEX(portCAN)]) < DEFER_RING_SIZE)
 	{
-	case CAN_0:
-		/*Enable the clock to CAN0*/
-		PCC->PCCn[PCC_FlexCAN0_INDEX] |= PCC_PCCn_CGC_MASK;
+		event = &deferRing[CAN_INDEX(portCAN)][head & (DEFER_RING_SIZE - 1)];
+		if (NULL != frame)
+			event->frame = *frame;
+		event->stamp = stamp;
+		event->kind = kind;
+		event->slot = slot;
+		event->status = status;
+		if (DEFER_TX_CALLBACK == kind)
+		{
+			/*The slot can take a new frame before the bottom half runs*/
+			event->done = txDone[CAN_INDEX(portCAN)][slot];
+			event->context = txContext[CAN_INDEX(portCAN)][slot];
+		}
+		deferHead[CAN_INDEX(portCAN)] = head + 1;
+	}
+	else
+	{
+		deferLost[CAN_INDEX(portCAN)]++;
+	}
+	CAN_ExitCritical(irqState);
 
-		/*Disable the CAN module before selecting clock*/
-		CAN0->MCR |= CAN_MCR_MDIS_MASK;
+	CAN_DeferPost(deferId, portCAN);
+}
 
+/*Give a frame to the bus monitor*/
+static void CAN_Monitor(PortCAN_t portCAN, const Rx_t* rxFrame, uint32_t stamp)
+{
+	CAN_Frame_t frame;
 
-		if (OSCILLATOR_SRC == CAN_Config->clkSource)
-			/*Choose the Oscillator Clock 8MHz*/
-			CAN0->CTRL1 &= ~CAN_CTRL1_CLKSRC_MASK;
-		else
-			/*Choose the Peripheral Clock*/
-			CAN0->CTRL1 |= CAN_CTRL1_CLKSRC_MASK;
+	frame.ID = rxFrame->RxID;
+	frame.Length = rxFrame->RxLength;
+	frame.Data[0] = rxFrame->RxData[0];
+	frame.Data[1] = rxFrame->RxData[1];
+	frame.Remote = (uint8_t)rxFrame->RxRemote;
 
+	busMonitor[CAN_INDEX(portCAN)](portCAN, &frame, stamp);
+}
 
-		/*Enable the CAN module*/
-		CAN0->MCR &= ~CAN_MCR_MDIS_MASK;
+/*Report a frame received to the bus monitor, the echoes of the port were reported when sent*/
+static void CAN_ObserveRx(PortCAN_t portCAN, const Rx_t* rxFrame)
+{
+	if ((NULL == busMonitor[CAN_INDEX(portCAN)]) || rxFrame->RxOwn)
+		return;
 
-		/*Wait for FRZACK to be frozen*/
-		while (!((CAN0->MCR & CAN_MCR_FRZACK_MASK) >> CAN_MCR_FRZACK_SHIFT));
+	if (deferOn[CAN_INDEX(portCAN)])
+		CAN_Defer(portCAN, DEFER_RX_MONITOR, rxFrame, CAN_ExtendStamp(portCAN, rxFrame->RxTimeStamp), 0, TX_DONE);
+	else
+		CAN_Monitor(portCAN, rxFrame, CAN_ExtendStamp(portCAN, rxFrame->RxTimeStamp));
+}
 
-		/*Now we can change the register in CTRL1*/
-		CAN_SetBitTime(portCAN, CAN_Config->clkSource, CAN_Config->bitTime, CAN_Config->timing);
+/*Report a frame sent by a TX MB to the bus monitor*/
+static void CAN_ObserveTx(PortCAN_t portCAN, uint8_t mb, uint32_t stamp)
+{
+	CAN_Type *base = CAN_INST(portCAN)->base;
+	Rx_t frame;
+	uint32_t cs = base->RAMn[MB_WORD(mb)];
+
+	frame.RxID = (base->RAMn[MB_WORD(mb) + 1] & CAN_WMBn_ID_ID_MASK) >> SHIFT_STD_ID;
+	frame.RxLength = (cs & CAN_WMBn_CS_DLC_MASK) >> CAN_WMBn_CS_DLC_SHIFT;
+	frame.RxData[0] = base->RAMn[MB_WORD(mb) + 2];
+	frame.RxData[1] = base->RAMn[MB_WORD(mb) + 3];
+	frame.RxRemote = (cs & CAN_WMBn_CS_RTR_MASK) ? 1 : 0;
+
+	if (deferOn[CAN_INDEX(portCAN)])
+		CAN_Defer(portCAN, DEFER_TX_MONITOR, &frame, stamp, 0, TX_DONE);
+	else
+		CAN_Monitor(portCAN, &frame, stamp);
+}
 
-		/*Loopback is enabled*/
-		CAN0->CTRL1 |= CAN_CTRL1_LPB_MASK;
+/*Push a frame to the RX ring*/
+static void CAN_RxPush(PortCAN_t portCAN, const Rx_t* frame)
+{
+	uint32_t head = rxRingHead[CAN_INDEX(portCAN)];
 
-		/*FIFO is disabled*/
-		CAN0->MCR &= ~ CAN_MCR_RFEN_MASK;
+	/*A full ring keeps the oldest frames*/
+	if ((head - rxRingTail[CAN_INDEX(portCAN)]) < RX_RING_SIZE)
+	{
+		rxRing[CAN_INDEX(portCAN)][head & (RX_RING_SIZE - 1)] = *frame;
+		rxRingHead[CAN_INDEX(portCAN)] = head + 1;
+	}
+	else
+	{
+		rxRingLost[CAN_INDEX(portCAN)]++;
+	}
+}
 
-		/*Self reception is enabled*/
-		CAN0->MCR &= ~ CAN_MCR_SRXDIS_MASK;
+/*Offer a frame to the hook of the port, the frames it does not take are queued*/
+static void CAN_RxDeliver(PortCAN_t portCAN, const Rx_t* frame)
+{
+	if ((NULL != rxHook[CAN_INDEX(portCAN)]) && deferOn[CAN_INDEX(portCAN)])
+		CAN_Defer(portCAN, DEFER_RX_DELIVER, frame, 0, 0, TX_DONE);
+	else if ((NULL == rxHook[CAN_INDEX(portCAN)]) || !rxHook[CAN_INDEX(portCAN)](portCAN, frame))
+		CAN_RxPush(portCAN, frame);
+}
 
-		/*Check all IDs*/
-		for(counter = 0; counter < MB_FILT; counter++)
-			CAN0->RXIMR[counter] = CHECK_ID;
+/*End of a remote request, the MB is stopped and an answer already in is queued. Returns 1 with an answer*/
+static uint8_t CAN_RemoteDone(PortCAN_t portCAN, uint8_t slot)
+{
+	CAN_Type *base = CAN_INST(portCAN)->base;
+	uint8_t mb = TX_POOL_FIRST + slot;
+	uint32_t mbWord = MB_WORD(mb);
+	uint32_t stamp;
+	uint32_t cs;
+	Rx_t frame;
+
+	/*Lock the MB, wait while an answer is moved in*/
+	do
+	{
+		cs = base->RAMn[mbWord];
+	} while (cs & CODE_BUSY_RX);
 
-		/*Global acceptance mask to check all the IDs*/
-		CAN0->RXMGMASK = CHECK_ALL_ID;
+	/*The confirmation gets the time stamp of the request, the answer wrote its own in the MB*/
+	stamp = txRemoteWait[CAN_INDEX(portCAN)][slot] ? txRemoteStamp[CAN_INDEX(portCAN)][slot] : (cs & TIME_STAMP_RX);
+	txRemoteWait[CAN_INDEX(portCAN)][slot] = 0;
+	base->RAMn[mbWord] = (cs & ~(CODE_MASK | TIME_STAMP_RX)) | CODE_TX_INACTIVE | CAN_WMBn_CS_RTR_MASK | stamp;
 
-		/*Disable the RX*/
-		CAN0->RAMn[RX_MB4] = DISABLE_RX;
+	frame.RxCode = (cs & CODE_MASK) >> SHIFT_CODE_RX;
+	if (frame.RxCode & CAN_RX_FULL)
+	{
+		frame.RxID       = (base->RAMn[mbWord + 1] & CAN_WMBn_ID_ID_MASK) >> SHIFT_STD_ID;
+		frame.RxLength   = (cs & CAN_WMBn_CS_DLC_MASK) >> CAN_WMBn_CS_DLC_SHIFT;
+		frame.RxRemote   = (cs & CAN_WMBn_CS_RTR_MASK) >> CAN_WMBn_CS_RTR_SHIFT;
+		frame.RxTimeStamp = cs & TIME_STAMP_RX;
+		frame.RxData[0]  = base->RAMn[mbWord + 2];
+		frame.RxData[1]  = base->RAMn[mbWord + 3];
+		frame.RxOwn      = 0;
+	}
 
-		/*Assign the standard ID to the next word of MB4*/
-		CAN0->RAMn[RX_MB4 + 1] = TX_ID_WORD;
+	/*Unlock message buffers, the flag of the answer is cleaned with the one of the request*/
+	(void)CAN_GetTime(portCAN);
+	base->IFLAG1 = 1UL << mb;
 
-		/*Enable the RX*/
-		CAN0->RAMn[RX_MB4] = ENABLE_RX;
+	if (!(frame.RxCode & CAN_RX_FULL))
+		return 0;
 
-		/*CAN FD is not used*/
-		CAN0->MCR = CANFD_NOT_USED;
+	CAN_ObserveRx(portCAN, &frame);
+	CAN_RxDeliver(portCAN, &frame);
 
-		/*Wait for FRZACK to be unfrozen*/
-		while ((CAN0->MCR && CAN_MCR_FRZACK_MASK) >> CAN_MCR_FRZACK_SHIFT);
+	return 1;
+}
 
-		/*Wait for CAN Module to be ready*/
-		while ((CAN0->MCR && CAN_MCR_NOTRDY_MASK) >> CAN_MCR_NOTRDY_SHIFT);
-		break;
+/*Release the TX MB of a slot and report its final status*/
+static void CAN_TxFinish(PortCAN_t portCAN, uint8_t slot, CAN_TxStatus_t status)
+{
+	CAN_TxDoneStats_t *cost = &txDoneStats[CAN_INDEX(portCAN)];
+	CAN_TxConfirm_t *confirm;
+	CAN_TxDone_t done = txDone[CAN_INDEX(portCAN)][slot];
+	uint32_t head = txConfirmHead[CAN_INDEX(portCAN)];
+	uint32_t start = CAN_CycleCount();
+	uint32_t stamp = 0;
+
+	/*FlexCAN writes the time stamp of the MB when the frame is sent*/
+	if (TX_DONE == status)
+	{
+		stamp = CAN_ExtendStamp(portCAN,
+				CAN_INST(portCAN)->base->RAMn[MB_WORD(TX_POOL_FIRST + slot)] & TIME_STAMP_RX);
 
-	case CAN_1:
-		/*Enable the clock to CAN1*/
-		PCC->PCCn[PCC_FlexCAN1_INDEX] |= PCC_PCCn_CGC_MASK;
+		if (NULL != busMonitor[CAN_INDEX(portCAN)])
+			CAN_ObserveTx(portCAN, TX_POOL_FIRST + slot, stamp);
+	}
+	txTime[CAN_INDEX(portCAN)][slot] = stamp;
 
-		/*Disable the CAN module before selecting clock*/
-		CAN1->MCR |= CAN_MCR_MDIS_MASK;
+	/*A full queue keeps the oldest confirmations, the frames with a completion callback skip it*/
+	if ((NULL == done) && ((head - txConfirmTail[CAN_INDEX(portCAN)]) < TX_CONFIRM_SIZE))
+	{
+		confirm = &txConfirm[CAN_INDEX(portCAN)][head & (TX_CONFIRM_SIZE - 1)];
+		confirm->tag = txTag[CAN_INDEX(portCAN)][slot];
+		confirm->context = txContext[CAN_INDEX(portCAN)][slot];
+		confirm->status = status;
+		confirm->timeStamp = stamp;
 
+		txConfirmHead[CAN_INDEX(portCAN)] = head + 1;
+	}
 
-		if (OSCILLATOR_SRC == CAN_Config->clkSource)
-			/*Choose the Oscillator Clock 8MHz*/
-			CAN1->CTRL1 &= ~CAN_CTRL1_CLKSRC_MASK;
-		else
-			/*Choose the Peripheral Clock*/
-			CAN1->CTRL1 |= CAN_CTRL1_CLKSRC_MASK;
+	txStatus[CAN_INDEX(portCAN)][slot] = status;
 
+	if (((NULL != txCallback[CAN_INDEX(portCAN)]) || (NULL != done)) && deferOn[CAN_INDEX(portCAN)])
+	{
+		CAN_Defer(portCAN, DEFER_TX_CALLBACK, NULL, stamp, slot, status);
+		done = NULL;
+	}
 
-		/*Enable the CAN module*/
-		CAN1->MCR &= ~CAN_MCR_MDIS_MASK;
+	/*Cost of the driver for one completion, the callbacks are not counted*/
+	start = CAN_CycleCount() - start;
+	cost->completions++;
+	cost->cycles += start;
+	if (start > cost->cyclesMax)
+		cost->cyclesMax = start;
 
-		/*Wait for FRZACK to be frozen*/
-		while (!((CAN1->MCR & CAN_MCR_FRZACK_MASK) >> CAN_MCR_FRZACK_SHIFT));
+	if (NULL != done)
+		done(portCAN, txContext[CAN_INDEX(portCAN)][slot], status, stamp);
 
-		/*Now we can change the register in CTRL1*/
-		CAN_SetBitTime(portCAN, CAN_Config->clkSource, CAN_Config->bitTime, CAN_Config->timing);
+	if ((NULL != txCallback[CAN_INDEX(portCAN)]) && !deferOn[CAN_INDEX(portCAN)])
+		txCallback[CAN_INDEX(portCAN)](portCAN, slot, status);
+}
 
-		/*Loopback is enabled*/
-		CAN1->CTRL1 |= CAN_CTRL1_LPB_MASK;
+/*Collect the TX MBs with the flag set*/
+static void CAN_TxComplete(PortCAN_t portCAN)
+{
+	CAN_Type *base = CAN_INST(portCAN)->base;
+	uint32_t flags;
+	uint32_t code;
+	uint8_t slot;
 
-		/*FIFO is disabled*/
-		CAN1->MCR &= ~ CAN_MCR_RFEN_MASK;
+	flags = base->IFLAG1 & TX_POOL_MASK;
+	if (!flags)
+		return;
 
-		/*Self reception is enabled*/
-		CAN1->MCR &= ~ CAN_MCR_SRXDIS_MASK;
+	for (slot = 0; slot < TX_POOL_SIZE; slot++)
+	{
+		if (flags & (1UL << (TX_POOL_FIRST + slot)))
+		{
+			/*INACTIVE after a transmission, ABORT when the abort won*/
+			code = base->RAMn[MB_WORD(TX_POOL_FIRST + slot)] & CODE_MASK;
+
+			/*Clean the flag of the MB*/
+			base->IFLAG1 = 1UL << (TX_POOL_FIRST + slot);
+
+			/*A remote request leaves the MB in RX EMPTY, the slot is held until the answer fills
+			  it or CAN_TxService ends it at the deadline*/
+			if (CODE_RX_EMPTY == code)
+			{
+				if (!txRemoteWait[CAN_INDEX(portCAN)][slot])
+				{
+					txRemoteWait[CAN_INDEX(portCAN)][slot] = 1;
+					txRemoteStamp[CAN_INDEX(portCAN)][slot] =
+							base->RAMn[MB_WORD(TX_POOL_FIRST + slot)] & TIME_STAMP_RX;
+				}
+
+				/*Unlock the MB for the answer*/
+				(void)CAN_GetTime(portCAN);
+				continue;
+			}
+
+			/*The other RX codes are the answer matched in the MB*/
+			if (!(code & CODE_TX_INACTIVE))
+				(void)CAN_RemoteDone(portCAN, slot);
+
+			if (CODE_TX_ABORT == code)
+				CAN_TxFinish(portCAN, slot, txAbortReason[CAN_INDEX(portCAN)][slot]);
+			else
+				CAN_TxFinish(portCAN, slot, TX_DONE);
+		}
+	}
 
-		/*Check all IDs*/
-		for(counter = 0; counter < MB_FILT; counter++)
-			CAN1->RXIMR[counter] = CHECK_ID;
+	/*The MBs released are filled again before the interrupt returns*/
+	if (NULL != txRefill[CAN_INDEX(portCAN)])
+		txRefill[CAN_INDEX(portCAN)](portCAN);
+}
 
-		/*Global acceptance mask to check all the IDs*/
-		CAN1->RXMGMASK = CHECK_ALL_ID;
+/*The TX interrupt collects the pool when someone waits for the MBs released*/
+static void CAN_TxIrqUpdate(PortCAN_t portCAN)
+{
+	if ((NULL != txCallback[CAN_INDEX(portCAN)]) || (NULL != txRefill[CAN_INDEX(portCAN)]) || txAsync[CAN_INDEX(portCAN)])
+	{
+		CAN_INST(portCAN)->base->IMASK1 |= TX_POOL_MASK;
+		CAN_EnableIRQ(CAN_INST(portCAN)->mbIrq);
+	}
+	else
+	{
+		CAN_INST(portCAN)->base->IMASK1 &= ~TX_POOL_MASK;
+	}
+}
 
-		/*Disable the RX*/
-		CAN1->RAMn[RX_MB4] = DISABLE_RX;
+/*Request the abort of a pending TX MB, the result is reported by its flag*/
+static void CAN_TxAbort(PortCAN_t portCAN, uint8_t slot, CAN_TxStatus_t reason)
+{
+	CAN_Type *base = CAN_INST(portCAN)->base;
+	uint32_t mbWord = MB_WORD(TX_POOL_FIRST + slot);
 
-		/*Assign the standard ID to the next word of MB4*/
-		CAN1->RAMn[RX_MB4 + 1] = TX_ID_WORD;
+	/*A frame already sent is collected by its flag, a remote request waiting for its answer by CAN_TxService*/
+	if ((TX_PENDING != txStatus[CAN_INDEX(portCAN)][slot]) ||
+		(base->IFLAG1 & (1UL << (TX_POOL_FIRST + slot))) || txRemoteWait[CAN_INDEX(portCAN)][slot])
+		return;
 
-		/*Enable the RX*/
-		CAN1->RAMn[RX_MB4] = ENABLE_RX;
+	txAbortReason[CAN_INDEX(portCAN)][slot] = reason;
+	txStatus[CAN_INDEX(portCAN)][slot] = TX_ABORTING;
+	base->RAMn[mbWord] = (base->RAMn[mbWord] & ~CODE_MASK) | CODE_TX_ABORT;
+}
 
-		/*CAN FD is not used*/
-		CAN1->MCR = CANFD_NOT_USED;
+/*MB of the frame in the bus, with LBUF = 0 the pending frame of lowest ID wins the arbitration*/
+static uint8_t CAN_TxSending(PortCAN_t portCAN)
+{
+	CAN_Type *base = CAN_INST(portCAN)->base;
+	uint32_t used = mbUsed[CAN_INDEX(portCAN)];
+	uint32_t lowest = CHECK_ID;
+	uint32_t code;
+	uint32_t idWord;
+	uint8_t sending = CAN_NO_MB;
+	uint8_t mb;
+
+	/*The MBs of the FIFO never transmit*/
+	if (rxAdaptive[CAN_INDEX(portCAN)])
+		used &= ~FIFO_MB_MASK;
+
+	for (mb = 0; mb < CAN_INST(portCAN)->mbCount; mb++)
+	{
+		if (!(used & (1UL << mb)))
+			continue;
+
+		/*An aborting MB keeps the bus until its frame ends*/
+		code = base->RAMn[MB_WORD(mb)] & CODE_MASK;
+		if ((CODE_FIELD_TX == code) || (CODE_TX_ABORT == code) || (CODE_TX_TANSWER == code))
+		{
+			idWord = base->RAMn[MB_WORD(mb) + 1] & CAN_WMBn_ID_ID_MASK;
+			if (idWord < lowest)
+			{
+				lowest = idWord;
+				sending = mb;
+			}
+		}
+	}
 
-		/*Wait for FRZACK to be unfrozen*/
-		while ((CAN1->MCR && CAN_MCR_FRZACK_MASK) >> CAN_MCR_FRZACK_SHIFT);
+	/*Reading the Control and Status of the RX MBs locked them*/
+	(void)CAN_GetTime(portCAN);
 
-		/*Wait for CAN Module to be ready*/
-		while ((CAN1->MCR && CAN_MCR_NOTRDY_MASK) >> CAN_MCR_NOTRDY_SHIFT);
-		break;
+	return sending;
+}
 
-	case CAN_2:
-		/*Enable the clock to CAN0*/
-		PCC->PCCn[PCC_FlexCAN2_INDEX] |= PCC_PCCn_CGC_MASK;
+/*Abort the one-shot frame that was in the bus during an error of transmission*/
+static void CAN_ErrorHandler(PortCAN_t portCAN)
+{
+	CAN_Type *base = CAN_INST(portCAN)->base;
+	uint32_t errors;
+	uint8_t mb;
 
-		/*Disable the CAN module before selecting clock*/
-		CAN2->MCR |= CAN_MCR_MDIS_MASK;
+	/*Reading ESR1 cleans the error bits, writing ERRINT cleans the interrupt*/
+	errors = base->ESR1;
+	base->ESR1 = CAN_ESR1_ERRINT_MASK;
 
+	if (errors & TX_ERRORS)
+	{
+		/*The frames that did not reach the arbitration stay pending*/
+		mb = CAN_TxSending(portCAN);
+		if ((mb >= TX_POOL_FIRST) && (mb < (TX_POOL_FIRST + TX_POOL_SIZE)) &&
+			(TX_ONE_SHOT == txMode[CAN_INDEX(portCAN)][mb - TX_POOL_FIRST]))
+			CAN_TxAbort(portCAN, mb - TX_POOL_FIRST, TX_FAILED);
+	}
+}
 
-		if (OSCILLATOR_SRC == CAN_Config->clkSource)
-			/*Choose the Oscillator Clock 8MHz*/
-			CAN2->CTRL1 &= ~CAN_CTRL1_CLKSRC_MASK;
-		else
-			/*Choose the Peripheral Clock*/
-			CAN2->CTRL1 |= CAN_CTRL1_CLKSRC_MASK;
+/*Frame to the TX pool, done and context are reported when it is finished*/
+static uint8_t CAN_SendFrame(PortCAN_t portCAN, const CAN_Frame_t* frame, const CAN_TxOptions_t* options,
+		CAN_TxDone_t done, void* context)
+{
+	CAN_Type *base = CAN_INST(portCAN)->base;
+	CAN_TxMode_t mode = TX_RETRY;
+	uint32_t deadline = 0;
+	uint32_t tag = 0;
+	uint32_t irqState;
+	uint32_t mbWord;
+	uint8_t slot;
+
+	/*Frames held by the admission check do not reach the pool*/
+	if (NULL != txAdmit[CAN_INDEX(portCAN)])
+	{
+		slot = txAdmit[CAN_INDEX(portCAN)](portCAN, frame, options, done, context);
+		if (CAN_TX_ADMITTED != slot)
+			return slot;
+	}
 
+	if (NULL != options)
+	{
+		mode = options->mode;
+		tag = options->tag;
 
-		/*Enable the CAN module*/
-		CAN2->MCR &= ~CAN_MCR_MDIS_MASK;
+		/*0 is reserved to no deadline*/
+		if (0 != options->timeout)
+			deadline = (CAN_GetTime(portCAN) + options->timeout) | 1;
+	}
 
-		/*Wait for FRZACK to be frozen*/
-		while (!((CAN2->MCR & CAN_MCR_FRZACK_MASK) >> CAN_MCR_FRZACK_SHIFT));
+	/*Take the first MB of the pool without a frame in flight*/
+	irqState = CAN_EnterCritical();
+	for (slot = 0; slot < TX_POOL_SIZE; slot++)
+	{
+		if ((TX_PENDING != txStatus[CAN_INDEX(portCAN)][slot]) && (TX_ABORTING != txStatus[CAN_INDEX(portCAN)][slot]))
+		{
+			txMode[CAN_INDEX(portCAN)][slot] = mode;
+			txDeadline[CAN_INDEX(portCAN)][slot] = deadline;
+			txTag[CAN_INDEX(portCAN)][slot] = tag;
+			txDone[CAN_INDEX(portCAN)][slot] = done;
+			txContext[CAN_INDEX(portCAN)][slot] = context;
+			txStatus[CAN_INDEX(portCAN)][slot] = TX_PENDING;
+			break;
+		}
+	}
+	CAN_ExitCritical(irqState);
 
-		/*Now we can change the register in CTRL1*/
-		CAN_SetBitTime(portCAN, CAN_Config->clkSource, CAN_Config->bitTime, CAN_Config->timing);
+	if (TX_POOL_SIZE == slot)
+		return CAN_TX_POOL_FULL;
 
-		/*Loopback is enabled*/
-		CAN2->CTRL1 |= CAN_CTRL1_LPB_MASK;
+	mbWord = MB_WORD(TX_POOL_FIRST + slot);
 
-		/*FIFO is disabled*/
-		CAN2->MCR &= ~ CAN_MCR_RFEN_MASK;
+	/*Errors are only watched while a one-shot frame is pending*/
+	if (TX_ONE_SHOT == mode)
+		base->CTRL1 |= CAN_CTRL1_ERRMSK_MASK;
 
-		/*Self reception is enabled*/
-		CAN2->MCR &= ~ CAN_MCR_SRXDIS_MASK;
+	/*The MB is inactive until every field is written*/
+	base->RAMn[mbWord] = CODE_TX_INACTIVE;
+	base->RAMn[mbWord + 1] = frame->ID << SHIFT_STD_ID;
+	base->RAMn[mbWord + 2] = frame->Data[0];
+	base->RAMn[mbWord + 3] = frame->Data[1];
 
-		/*Check all IDs*/
-		for(counter = 0; counter < MB_FILT; counter++)
-			CAN2->RXIMR[counter] = CHECK_ID;
+	/*Code, length, SRR and RTR in a single write*/
+	base->RAMn[mbWord] = CODE_FIELD_TX | SRR_TX | (frame->Length << CAN_WMBn_CS_DLC_SHIFT) |
+			(frame->Remote ? CAN_WMBn_CS_RTR_MASK : 0);
 
-		/*Global acceptance mask to check all the IDs*/
-		CAN2->RXMGMASK = CHECK_ALL_ID;
+	return slot;
+}
 
-		/*Disable the RX*/
-		CAN2->RAMn[RX_MB4] = DISABLE_RX;
+uint8_t CAN_Send(PortCAN_t portCAN, const CAN_Frame_t* frame, const CAN_TxOptions_t* options)
+{
+	return CAN_SendFrame(portCAN, frame, options, NULL, NULL);
+}
 
-		/*Assign the standard ID to the next word of MB4*/
-		CAN2->RAMn[RX_MB4 + 1] = TX_ID_WORD;
+uint8_t CAN_SendAsync(PortCAN_t portCAN, const CAN_Frame_t* frame, const CAN_TxOptions_t* options,
+		CAN_TxDone_t done, void* context)
+{
+	/*The completions are collected by the TX interrupt from the first asynchronous frame*/
+	if (!txAsync[CAN_INDEX(portCAN)])
+	{
+		txAsync[CAN_INDEX(portCAN)] = 1;
+		CAN_TxIrqUpdate(portCAN);
+	}
 
-		/*Enable the RX*/
-		CAN2->RAMn[RX_MB4] = ENABLE_RX;
+	return CAN_SendFrame(portCAN, frame, options, done, context);
+}
 
-		/*CAN FD is not used*/
-		CAN2->MCR = CANFD_NOT_USED;
+void CAN_GetTxDoneStats(PortCAN_t portCAN, CAN_TxDoneStats_t* stats)
+{
+	uint32_t irqState;
 
-		/*Wait for FRZACK to be unfrozen*/
-		while ((CAN2->MCR && CAN_MCR_FRZACK_MASK) >> CAN_MCR_FRZACK_SHIFT);
+	irqState = CAN_EnterCritical();
+	*stats = txDoneStats[CAN_INDEX(portCAN)];
+	CAN_ExitCritical(irqState);
+}
 
-		/*Wait for CAN Module to be ready*/
-		while ((CAN2->MCR && CAN_MCR_NOTRDY_MASK) >> CAN_MCR_NOTRDY_SHIFT);
-		break;
+/*Take the highest free MB, the lowest ones are left to the RX FIFO*/
+static uint8_t CAN_AllocMB(PortCAN_t portCAN)
+{
+	uint32_t irqState;
+	uint8_t mb;
 
-	default:
-		break;
+	irqState = CAN_EnterCritical();
+	for (mb = CAN_INST(portCAN)->mbCount; mb > 0; mb--)
+	{
+		if (!(mbUsed[CAN_INDEX(portCAN)] & (1UL << (mb - 1))))
+		{
+			mbUsed[CAN_INDEX(portCAN)] |= 1UL << (mb - 1);
+			break;
+		}
 	}
+	CAN_ExitCritical(irqState);
+
+	return (mb > 0) ? (mb - 1) : CAN_NO_MB;
 }
 
-/*Transmit the data through of channel CAN 0 with two data */
-void CAN_Transmitter(PortCAN_t portCAN, uint32_t dataWord1, uint32_t dataWord2)
+uint8_t CAN_ClaimMB(PortCAN_t portCAN, uint8_t mb)
 {
-	switch(portCAN)
+	uint32_t irqState;
+	uint8_t claimed = 0;
+
+	if (mb >= CAN_INST(portCAN)->mbCount)
+		return 0;
+
+	irqState = CAN_EnterCritical();
+	if (!(mbUsed[CAN_INDEX(portCAN)] & (1UL << mb)))
 	{
-	case CAN_0:
-		/*Clean MB0 flag*/
-		CAN0->IFLAG1 = CLEAN_MB0;
+		mbUsed[CAN_INDEX(portCAN)] |= 1UL << mb;
+		claimed = 1;
+	}
+	CAN_ExitCritical(irqState);
 
-		/*Data word 1 in the third position of MB0*/
-		CAN0->RAMn[TX_MB0 + 2] = dataWord1;
+	return claimed;
+}
+
+uint8_t CAN_ArmTx(PortCAN_t portCAN, const CAN_Frame_t* frame, CAN_TxTrigger_t* trigger)
+{
+	CAN_Type *base = CAN_INST(portCAN)->base;
+	uint8_t mb = CAN_AllocMB(portCAN);
+	uint32_t mbWord;
+
+	if (CAN_NO_MB == mb)
+		return mb;
+
+	mbWord = MB_WORD(mb);
+	base->RAMn[mbWord] = CODE_TX_INACTIVE;
+	base->RAMn[mbWord + 1] = frame->ID << SHIFT_STD_ID;
+	base->RAMn[mbWord + 2] = frame->Data[0];
+	base->RAMn[mbWord + 3] = frame->Data[1];
+
+	/*Everything but the code is written, the launch is one store*/
+	trigger->cs = &base->RAMn[mbWord];
+	trigger->code = CODE_FIELD_TX | SRR_TX | (frame->Length << CAN_WMBn_CS_DLC_SHIFT) |
+			(frame->Remote ? CAN_WMBn_CS_RTR_MASK : 0);
+	trigger->port = portCAN;
+	trigger->mb = mb;
+
+	return mb;
+}
 
-		/*Data word 2 in the fourth position of MB0*/
-		CAN0->RAMn[TX_MB0 + 3] = dataWord2;
+uint8_t CAN_UpdateArmedTx(const CAN_TxTrigger_t* trigger, uint32_t dataWord1, uint32_t dataWord2)
+{
+	uint32_t irqState;
+	uint8_t written = 0;
 
-		/* Standard ID 0x555, first position of MB0*/
-		CAN0->RAMn[TX_MB0 + 1] = TX_ID_WORD;
+	/*The trigger interrupt is not masked by CAN_EnterCritical, both words go in one launch*/
+	irqState = CAN_EnterCriticalAll();
+	if (CODE_TX_INACTIVE == (trigger->cs[0] & CODE_MASK))
+	{
+		trigger->cs[2] = dataWord1;
+		trigger->cs[3] = dataWord2;
+		written = 1;
+	}
+	CAN_ExitCriticalAll(irqState);
 
-		/*SETUP OF THE TX*/
-		/*Set the length of DLC*/
-		CAN0->RAMn[TX_MB0 + 0] |= (DLC_LENGTH << CAN_WMBn_CS_DLC_SHIFT);
+	return written;
+}
 
-		/*Assign the code to transmit MB*/
-		CAN0->RAMn[TX_MB0 + 0] |= CODE_FIELD_TX;
+uint8_t CAN_AddRemoteResponse(PortCAN_t portCAN, const CAN_Frame_t* response)
+{
+	uint8_t mb = CAN_AllocMB(portCAN);
 
-		/*Set TX frame*/
-		CAN0->RAMn[TX_MB0 + 0] |= SRR_TX;
-		break;
+	if (CAN_NO_MB != mb)
+		CAN_UpdateRemoteResponse(portCAN, mb, response);
 
-	case CAN_1:
-		/*Clean MB0 flag*/
-		CAN1->IFLAG1 = CLEAN_MB0;
+	return mb;
+}
 
-		/*Data word 1 in the third position of MB0*/
-		CAN1->RAMn[TX_MB0 + 2] = dataWord1;
+void CAN_UpdateRemoteResponse(PortCAN_t portCAN, uint8_t mb, const CAN_Frame_t* response)
+{
+	CAN_Type *base = CAN_INST(portCAN)->base;
+	uint32_t mbWord = MB_WORD(mb);
 
-		/*Data word 2 in the fourth position of MB0*/
-		CAN1->RAMn[TX_MB0 + 3] = dataWord2;
+	/*The MB does not match requests until the response is written*/
+	base->RAMn[mbWord] = CODE_RX_INACTIVE;
+	base->RAMn[mbWord + 1] = response->ID << SHIFT_STD_ID;
+	base->RAMn[mbWord + 2] = response->Data[0];
+	base->RAMn[mbWord + 3] = response->Data[1];
 
-		/* Standard ID 0x555, first position of MB0*/
-		CAN1->RAMn[TX_MB0 + 1] = TX_ID_WORD;
+	/*A matching request turns the MB in TANSWER and the response is sent*/
+	base->RAMn[mbWord] = CODE_RX_RANSWER | SRR_TX | (response->Length << CAN_WMBn_CS_DLC_SHIFT);
+}
 
-		/*SETUP OF THE TX*/
-		/*Set the length of DLC*/
-		CAN1->RAMn[TX_MB0 + 0] |= (DLC_LENGTH << CAN_WMBn_CS_DLC_SHIFT);
+CAN_TxStatus_t CAN_GetTxStatus(PortCAN_t portCAN, uint8_t handle)
+{
+	return txStatus[CAN_INDEX(portCAN)][handle];
+}
 
-		/*Assign the code to transmit MB*/
-		CAN1->RAMn[TX_MB0 + 0] |= CODE_FIELD_TX;
+void CAN_TxService(PortCAN_t portCAN)
+{
+	uint32_t irqState;
+	uint32_t now;
+	uint8_t slot;
+	uint8_t oneShot = 0;
+	uint8_t released = 0;
 
-		/*Set TX frame*/
-		CAN1->RAMn[TX_MB0 + 0] |= SRR_TX;
-		break;
+	now = CAN_GetTime(portCAN);
 
-	case CAN_2:
-		/*Clean MB0 flag*/
-		CAN2->IFLAG1 = CLEAN_MB0;
+	irqState = CAN_EnterCritical();
 
-		/*Data word 1 in the third position of MB0*/
-		CAN2->RAMn[TX_MB0 + 2] = dataWord1;
+	/*With a callback or a refill the frames are collected by the interrupt*/
+	if (!(CAN_INST(portCAN)->base->IMASK1 & TX_POOL_MASK))
+		CAN_TxComplete(portCAN);
 
-		/*Data word 2 in the fourth position of MB0*/
-		CAN2->RAMn[TX_MB0 + 3] = dataWord2;
+	for (slot = 0; slot < TX_POOL_SIZE; slot++)
+	{
+		if ((0 != txDeadline[CAN_INDEX(portCAN)][slot]) && ((int32_t)(now - txDeadline[CAN_INDEX(portCAN)][slot]) >= 0))
+		{
+			/*The request was sent, only the wait for its answer is ended*/
+			if (txRemoteWait[CAN_INDEX(portCAN)][slot])
+			{
+				CAN_TxFinish(portCAN, slot, CAN_RemoteDone(portCAN, slot) ? TX_DONE : TX_TIMEOUT);
+				released = 1;
+			}
+			else
+			{
+				CAN_TxAbort(portCAN, slot, TX_TIMEOUT);
+			}
+		}
+
+		if ((TX_PENDING == txStatus[CAN_INDEX(portCAN)][slot]) && (TX_ONE_SHOT == txMode[CAN_INDEX(portCAN)][slot]))
+			oneShot = 1;
+	}
 
-		/* Standard ID 0x555, first position of MB0*/
-		CAN2->RAMn[TX_MB0 + 1] = TX_ID_WORD;
+	/*The slots of the remote requests released here are filled as the TX interrupt does*/
+	if (released && (NULL != txRefill[CAN_INDEX(portCAN)]))
+		txRefill[CAN_INDEX(portCAN)](portCAN);
 
-		/*SETUP OF THE TX*/
-		/*Set the length of DLC*/
-		CAN2->RAMn[TX_MB0 + 0] |= (DLC_LENGTH << CAN_WMBn_CS_DLC_SHIFT);
+	/*Stop the error interrupt when no one-shot frame is left*/
+	if (!oneShot)
+		CAN_INST(portCAN)->base->CTRL1 &= ~CAN_CTRL1_ERRMSK_MASK;
 
-		/*Assign the code to transmit MB*/
-		CAN2->RAMn[TX_MB0 + 0] |= CODE_FIELD_TX;
+	CAN_ExitCritical(irqState);
+}
 
-		/*Set TX frame*/
-		CAN2->RAMn[TX_MB0 + 0] |= SRR_TX;
-		break;
-	default:
-		break;
+void CAN_SetTxCallback(PortCAN_t portCAN, CAN_TxCallback_t callback)
+{
+	txCallback[CAN_INDEX(portCAN)] = callback;
+	CAN_TxIrqUpdate(portCAN);
+}
+
+void CAN_SetTxRefill(PortCAN_t portCAN, CAN_TxRefill_t refill)
+{
+	txRefill[CAN_INDEX(portCAN)] = refill;
+	CAN_TxIrqUpdate(portCAN);
+}
+
+uint32_t CAN_GetTxTime(PortCAN_t portCAN, uint8_t handle)
+{
+	return txTime[CAN_INDEX(portCAN)][handle];
+}
+
+void CAN_SetTxAdmit(PortCAN_t portCAN, CAN_TxAdmit_t admit)
+{
+	txAdmit[CAN_INDEX(portCAN)] = admit;
+}
+
+uint32_t CAN_GetTxConfirm(PortCAN_t portCAN, CAN_TxConfirm_t* confirm, uint32_t max)
+{
+	uint32_t tail = txConfirmTail[CAN_INDEX(portCAN)];
+	uint32_t count = 0;
+
+	while ((count < max) && (tail != txConfirmHead[CAN_INDEX(portCAN)]))
+	{
+		confirm[count] = txConfirm[CAN_INDEX(portCAN)][tail & (TX_CONFIRM_SIZE - 1)];
+		tail++;
+		count++;
 	}
+
+	/*Free the entries once they are copied*/
+	txConfirmTail[CAN_INDEX(portCAN)] = tail;
+
+	return count;
 }
 
-/*Receive the data though the channel and only is received two data*/
-void CAN_Receiver(PortCAN_t portCAN, uint32_t *data1, uint32_t *data2)
+uint32_t CAN_GetTime(PortCAN_t portCAN)
+{
+	uint32_t irqState;
+	uint32_t now;
+
+	irqState = CAN_EnterCritical();
+
+	/*Reading the timer also unlocks the message buffers*/
+	now = CAN_INST(portCAN)->base->TIMER & TIMER_MASK;
+	if (now < timeLast[CAN_INDEX(portCAN)])
+		timeHigh[CAN_INDEX(portCAN)] += TIMER_WRAP;
+	timeLast[CAN_INDEX(portCAN)] = now;
+	now |= timeHigh[CAN_INDEX(portCAN)];
+
+	CAN_ExitCritical(irqState);
+
+	return now;
+}
+
+/*A frame is an echo of the port when a TX MB sent the same ID at the same time*/
+static uint32_t CAN_IsOwnFrame(PortCAN_t portCAN, uint32_t idWord, uint32_t stamp)
+{
+	CAN_Type *base = CAN_INST(portCAN)->base;
+	uint32_t mbWord;
+	uint8_t slot;
+
+	if (!selfRx[CAN_INDEX(portCAN)])
+		return 0;
+
+	/*The time stamp of both MBs is taken from the same bit of the same frame*/
+	for (slot = 0; slot < TX_POOL_SIZE; slot++)
+	{
+		mbWord = MB_WORD(TX_POOL_FIRST + slot);
+		if ((base->RAMn[mbWord + 1] == idWord) && ((base->RAMn[mbWord] & TIME_STAMP_RX) == stamp))
+			return 1;
+	}
+
+	return 0;
+}
+
+/*Copy a RX MB with a frame and count the frames lost, flag is the flag of the MB seen while it was locked*/
+static uint32_t CAN_ReadRxMBFlag(PortCAN_t portCAN, uint8_t mb, Rx_t* frame, uint32_t* flag)
 {
+	CAN_Type *base = CAN_INST(portCAN)->base;
+	uint32_t mbWord = MB_WORD(mb);
+	uint32_t cs;
 	uint8_t counter;
-	uint32_t dummy;
 
-	switch(portCAN)
+	/*Reading the Control and Status locks the MB, wait while it is being filled*/
+	do
 	{
-	case CAN_0:
-		/*Obtain the code of RX with the first word of MB4*/
-		rx.RxCode   = (CAN0->RAMn[RX_MB4] & CODE_MASK_RX) >> SHIFT_CODE_RX;
+		cs = base->RAMn[mbWord];
+	} while (cs & CODE_BUSY_RX);
 
-		/*Obtain the ID of RX with the next word of MB4*/
-		rx.RxID     = (CAN0->RAMn[RX_MB4 + 1] & CAN_WMBn_ID_ID_MASK)  >> CAN_WMBn_ID_ID_SHIFT;
+	frame->RxCode = (cs & CODE_MASK) >> SHIFT_CODE_RX;
 
-		/*Obtain the length of RX with the first word of MB4*/
-		rx.RxLength = (CAN0->RAMn[RX_MB4] & CAN_WMBn_CS_DLC_MASK) >> CAN_WMBn_CS_DLC_SHIFT;
+	if ((CAN_RX_FULL == frame->RxCode) || (CAN_RX_OVERRUN == frame->RxCode))
+	{
+		/*Obtain the ID, the length and the RTR bit*/
+		frame->RxID     = (base->RAMn[mbWord + 1] & CAN_WMBn_ID_ID_MASK) >> SHIFT_STD_ID;
+		frame->RxLength = (cs & CAN_WMBn_CS_DLC_MASK) >> CAN_WMBn_CS_DLC_SHIFT;
+		frame->RxRemote = (cs & CAN_WMBn_CS_RTR_MASK) >> CAN_WMBn_CS_RTR_SHIFT;
 
 		/*Read the data received*/
 		for (counter = 0; counter < MAX_DATA; counter++)
-		  rx.RxData[counter] = CAN0->RAMn[RX_DATA_MB4 + counter];
-
-		/*Save the data received*/
-		data1 = rx.RxData[0];
-		data2 = rx.RxData[1];
+			frame->RxData[counter] = base->RAMn[mbWord + 2 + counter];
 
 		/*Obtain the time stamp*/
-		rx.RxTimeStamp = (CAN0->RAMn[RX_MB4] & TIME_STAMP_RX);
+		frame->RxTimeStamp = cs & TIME_STAMP_RX;
 
-		/*Unlock message buffers*/
-		dummy = CAN0->TIMER;
+		/*Tag the frames sent by the port*/
+		frame->RxOwn = CAN_IsOwnFrame(portCAN, base->RAMn[mbWord + 1], frame->RxTimeStamp);
+	}
 
-		/*Clean MB4 flag*/
-		CAN0->IFLAG1 = MB4_CLEAN_FLAG;
-		break;
+	/*Clean the flag while no frame can be moved in, a frame after the unlock sets it again*/
+	*flag = base->IFLAG1 & (1UL << mb);
+	base->IFLAG1 = *flag;
 
-	case CAN_1:
-		/*Obtain the code of RX with the first word of MB4*/
-		rx.RxCode   = (CAN1->RAMn[RX_MB4] & CODE_MASK_RX) >> SHIFT_CODE_RX;
+	/*Unlock message buffers, reading the timer keeps the time of the port*/
+	(void)CAN_GetTime(portCAN);
 
-		/*Obtain the ID of RX with the next word of MB4*/
-		rx.RxID     = (CAN1->RAMn[RX_MB4 + 1] & CAN_WMBn_ID_ID_MASK)  >> CAN_WMBn_ID_ID_SHIFT;
+	if (frame->RxCode & CAN_RX_FULL)
+		CAN_ObserveRx(portCAN, frame);
 
-		/*Obtain the length of RX with the first word of MB4*/
-		rx.RxLength = (CAN1->RAMn[RX_MB4] & CAN_WMBn_CS_DLC_MASK) >> CAN_WMBn_CS_DLC_SHIFT;
+	/*The frame before the last one was lost, a latest value is only replaced*/
+	if ((CAN_RX_OVERRUN == frame->RxCode) && !(rxLatestMask[CAN_INDEX(portCAN)] & (1UL << mb)))
+		CAN_ReportOverrun(portCAN, mb);
 
-		/*Read the data received*/
-		for (counter = 0; counter < MAX_DATA; counter++)
-		  rx.RxData[counter] = CAN1->RAMn[RX_DATA_MB4 + counter];
+	return frame->RxCode;
+}
 
-		/*Save the data received*/
-		data1 = rx.RxData[0];
-		data2 = rx.RxData[1];
+/*Copy a RX MB with a frame and count the frames lost, return the code of the MB*/
+static uint32_t CAN_ReadRxMB(PortCAN_t portCAN, uint8_t mb, Rx_t* frame)
+{
+	uint32_t flag;
 
-		/*Obtain the time stamp*/
-		rx.RxTimeStamp = (CAN1->RAMn[RX_MB4] & TIME_STAMP_RX);
+	return CAN_ReadRxMBFlag(portCAN, mb, frame, &flag);
+}
 
-		/*Unlock message buffers*/
-		dummy = CAN1->TIMER;
+/*Receive the data though the channel and only is received two data*/
+void CAN_Receiver(PortCAN_t portCAN, uint32_t *data1, uint32_t *data2)
+{
+	uint32_t code;
 
-		/*Clean MB4 flag*/
-		CAN1->IFLAG1 = MB4_CLEAN_FLAG;
-		break;
+	code = CAN_ReadRxMB(portCAN, RX_MB4 / WORDS_PER_MB, &rx);
+
+	/*Save the data received*/
+	if ((CAN_RX_FULL == code) || (CAN_RX_OVERRUN == code))
+	{
+		*data1 = rx.RxData[0];
+		*data2 = rx.RxData[1];
+	}
+}
 
-	case CAN_2:
-		/*Obtain the code of RX with the first word of MB4*/
-		rx.RxCode   = (CAN2->RAMn[RX_MB4] & CODE_MASK_RX) >> SHIFT_CODE_RX;
+/*Copy a RX_SIGNAL MB to the signal store, the sequence is odd during the copy*/
+static void CAN_SignalUpdate(PortCAN_t portCAN, uint8_t mb)
+{
+	Signal_t *signal = &rxSignal[CAN_INDEX(portCAN)][mb];
+	Rx_t frame;
 
-		/*Obtain the ID of RX with the next word of MB4*/
-		rx.RxID     = (CAN2->RAMn[RX_MB4 + 1] & CAN_WMBn_ID_ID_MASK)  >> CAN_WMBn_ID_ID_SHIFT;
+	if (CAN_ReadRxMB(portCAN, mb, &frame) & CAN_RX_FULL)
+	{
+		signal->seq++;
+		CAN_MemoryBarrier();
+		signal->value = frame;
+		CAN_MemoryBarrier();
+		signal->seq++;
+	}
+}
 
-		/*Obtain the length of RX with the first word of MB4*/
-		rx.RxLength = (CAN2->RAMn[RX_MB4] & CAN_WMBn_CS_DLC_MASK) >> CAN_WMBn_CS_DLC_SHIFT;
+/*Count a frame of the adaptive mode, a new ID replaces the coldest one*/
+static void CAN_ProfileID(PortCAN_t portCAN, uint32_t id)
+{
+	HotID_t *hot = rxHot[CAN_INDEX(portCAN)];
+	HotID_t *coldest = NULL;
+	uint8_t entry;
 
-		/*Read the data received*/
+	for (entry = 0; entry < HOT_TABLE_SIZE; entry++)
+	{
+		if (hot[entry].ID == id)
+		{
+			hot[entry].count++;
+			return;
+		}
+
+		/*The promoted IDs are never replaced*/
+		if ((CAN_NO_MB == hot[entry].mb) && ((NULL == coldest) || (hot[entry].count < coldest->count)))
+			coldest = &hot[entry];
+	}
+
+	/*The new ID inherits the count of the replaced one*/
+	if (NULL != coldest)
+	{
+		coldest->ID = id;
+		coldest->count++;
+	}
+}
+
+/*Bottom half of a port, runs from PendSV after the interrupts*/
+static void CAN_BottomHalf(PortCAN_t portCAN)
+{
+	Deferred_t *event;
+	uint32_t irqState;
+	uint32_t tail = deferTail[CAN_INDEX(portCAN)];
+
+	while (tail != deferHead[CAN_INDEX(portCAN)])
+	{
+		event = &deferRing[CAN_INDEX(portCAN)][tail & (DEFER_RING_SIZE - 1)];
+
+		switch (event->kind)
+		{
+		case DEFER_RX_MONITOR:
+		case DEFER_TX_MONITOR:
+			if (NULL != busMonitor[CAN_INDEX(portCAN)])
+				CAN_Monitor(portCAN, &event->frame, event->stamp);
+			break;
+
+		case DEFER_RX_DELIVER:
+			if ((NULL == rxHook[CAN_INDEX(portCAN)]) || !rxHook[CAN_INDEX(portCAN)](portCAN, &event->frame))
+			{
+				/*The RX interrupt writes the same ring*/
+				irqState = CAN_EnterCritical();
+				CAN_RxPush(portCAN, &event->frame);
+				CAN_ExitCritical(irqState);
+			}
+			break;
+
+		case DEFER_TX_CALLBACK:
+			if (NULL != event->done)
+				event->done(portCAN, event->context, event->status, event->stamp);
+			if (NULL != txCallback[CAN_INDEX(portCAN)])
+				txCallback[CAN_INDEX(portCAN)](portCAN, event->slot, event->status);
+			break;
+		}
+
+		tail++;
+		deferTail[CAN_INDEX(portCAN)] = tail;
+	}
+}
+
+/*Move at most max frames of the RX FIFO to the RX ring, returns the frames moved*/
+static uint32_t CAN_FifoComplete(PortCAN_t portCAN, uint32_t max)
+{
+	CAN_Type *base = CAN_INST(portCAN)->base;
+	Rx_t frame;
+	uint32_t cs;
+	uint32_t moved = 0;
+	uint8_t counter;
+
+	/*A frame lost by the FIFO is counted as an overrun of the port*/
+	if (base->IFLAG1 & FIFO_OVERFLOW)
+	{
+		base->IFLAG1 = FIFO_OVERFLOW;
+		rxPortOverrun[CAN_INDEX(portCAN)]++;
+
+		if (NULL != rxOverrunCallback[CAN_INDEX(portCAN)])
+			rxOverrunCallback[CAN_INDEX(portCAN)](portCAN, 0);
+	}
+
+	while ((moved < max) && (base->IFLAG1 & FIFO_AVAILABLE))
+	{
+		/*The output of the FIFO is in MB0*/
+		cs = base->RAMn[0];
+		frame.RxCode     = CAN_RX_FULL;
+		frame.RxID       = (base->RAMn[1] & CAN_WMBn_ID_ID_MASK) >> SHIFT_STD_ID;
+		frame.RxLength   = (cs & CAN_WMBn_CS_DLC_MASK) >> CAN_WMBn_CS_DLC_SHIFT;
+		frame.RxRemote   = (cs & CAN_WMBn_CS_RTR_MASK) >> CAN_WMBn_CS_RTR_SHIFT;
+		frame.RxTimeStamp = cs & TIME_STAMP_RX;
 		for (counter = 0; counter < MAX_DATA; counter++)
-		  rx.RxData[counter] = CAN2->RAMn[RX_DATA_MB4 + counter];
+			frame.RxData[counter] = base->RAMn[2 + counter];
+		frame.RxOwn = CAN_IsOwnFrame(portCAN, base->RAMn[1], frame.RxTimeStamp);
 
-		/*Save the data received*/
-		data1 = rx.RxData[0];
-		data2 = rx.RxData[1];
+		/*Clean the flag to move the next frame to the output*/
+		base->IFLAG1 = FIFO_AVAILABLE;
 
-		/*Obtain the time stamp*/
-		rx.RxTimeStamp = (CAN2->RAMn[RX_MB4] & TIME_STAMP_RX);
+		CAN_ObserveRx(portCAN, &frame);
+		CAN_ProfileID(portCAN, frame.RxID);
+		CAN_RxDeliver(portCAN, &frame);
+		moved++;
+	}
 
-		/*Unlock message buffers*/
-		dummy = CAN2->TIMER;
+	/*The watermark is passed again only after the FIFO was drained*/
+	if (!(base->IFLAG1 & FIFO_AVAILABLE))
+		base->IFLAG1 = FIFO_WARNING;
+	rxIrqStats[CAN_INDEX(portCAN)].frames += moved;
 
-		/*Clean MB4 flag*/
-		CAN2->IFLAG1 = MB4_CLEAN_FLAG;
-		break;
-	default:
-		break;
+	return moved;
+}
+
+/*Count the frames of the FIFO interrupt, a burst masks the FIFO and leaves it to CAN_RxNapiPoll*/
+static void CAN_NapiCheck(PortCAN_t portCAN, uint32_t moved)
+{
+	CAN_RxNapi_t *napi = &rxNapi[CAN_INDEX(portCAN)];
+	uint32_t now;
+
+	if ((0 == napi->burstFrames) || rxNapiPolling[CAN_INDEX(portCAN)])
+		return;
+
+	now = CAN_GetTime(portCAN);
+	if ((now - rxNapiWindow[CAN_INDEX(portCAN)]) > napi->burstWindow)
+	{
+		rxNapiWindow[CAN_INDEX(portCAN)] = now;
+		rxNapiFrames[CAN_INDEX(portCAN)] = 0;
+	}
+	rxNapiFrames[CAN_INDEX(portCAN)] += moved;
+
+	if (rxNapiFrames[CAN_INDEX(portCAN)] >= napi->burstFrames)
+	{
+		/*The overflow interrupt stays to count the frames lost*/
+		CAN_INST(portCAN)->base->IMASK1 &= ~(FIFO_AVAILABLE | FIFO_WARNING);
+		rxNapiStats[CAN_INDEX(portCAN)].timeInterrupt += now - rxNapiSince[CAN_INDEX(portCAN)];
+		rxNapiStats[CAN_INDEX(portCAN)].toPolling++;
+		rxNapiSince[CAN_INDEX(portCAN)] = now;
+		rxNapiPolling[CAN_INDEX(portCAN)] = 1;
+	}
+}
+
+/*Move the queued RX MBs with the flag set to the RX ring*/
+static void CAN_RxComplete(PortCAN_t portCAN, uint32_t flags)
+{
+	Rx_t *frame;
+	Rx_t hooked;
+	Rx_t dropped;
+	uint32_t head;
+	uint32_t moved;
+	uint8_t mb;
+
+	for (mb = 0; flags; mb++, flags >>= 1)
+	{
+		if ((flags & 1) && (rxSignalMask[CAN_INDEX(portCAN)] & (1UL << mb)))
+		{
+			CAN_SignalUpdate(portCAN, mb);
+		}
+		else if ((flags & 1) && rxAdaptive[CAN_INDEX(portCAN)] && ((1UL << mb) & FIFO_MB_MASK))
+		{
+			/*The flags of the FIFO are in MB5-MB7*/
+			rxIrqStats[CAN_INDEX(portCAN)].interrupts++;
+			moved = CAN_FifoComplete(portCAN, rxNapiPolling[CAN_INDEX(portCAN)] ? 0 : FIFO_DRAIN);
+			CAN_NapiCheck(portCAN, moved);
+			flags &= ~(FIFO_MB_MASK >> mb);
+		}
+		else if ((flags & 1) && (NULL != rxHook[CAN_INDEX(portCAN)]))
+		{
+			/*The hook sees the frame before the ring, even when the ring is full*/
+			if (CAN_ReadRxMB(portCAN, mb, &hooked) & CAN_RX_FULL)
+			{
+				if (rxAdaptive[CAN_INDEX(portCAN)])
+					CAN_ProfileID(portCAN, hooked.RxID);
+
+				CAN_RxDeliver(portCAN, &hooked);
+			}
+		}
+		else if (flags & 1)
+		{
+			head = rxRingHead[CAN_INDEX(portCAN)];
+
+			/*A full ring keeps the oldest frames*/
+			if ((head - rxRingTail[CAN_INDEX(portCAN)]) < RX_RING_SIZE)
+			{
+				/*FULL and OVERRUN both hold a frame*/
+				frame = &rxRing[CAN_INDEX(portCAN)][head & (RX_RING_SIZE - 1)];
+				if (CAN_ReadRxMB(portCAN, mb, frame) & CAN_RX_FULL)
+				{
+					if (rxAdaptive[CAN_INDEX(portCAN)])
+						CAN_ProfileID(portCAN, frame->RxID);
+
+					rxRingHead[CAN_INDEX(portCAN)] = head + 1;
+				}
+			}
+			else
+			{
+				/*The frame read to free the MB is dropped, rx belongs to CAN_Receiver*/
+				CAN_ReadRxMB(portCAN, mb, &dropped);
+				rxRingLost[CAN_INDEX(portCAN)]++;
+			}
+		}
+	}
+}
+
+/*Interrupt of the message buffers, only the MBs with the interrupt enabled*/
+static void CAN_MBHandler(PortCAN_t portCAN)
+{
+	CAN_Type *base = CAN_INST(portCAN)->base;
+	uint32_t start = CAN_CycleCount();
+	uint32_t flags;
+
+	flags = base->IFLAG1 & base->IMASK1;
+
+	if (flags & TX_POOL_MASK)
+		CAN_TxComplete(portCAN);
+
+	if (flags & ~TX_POOL_MASK)
+		CAN_RxComplete(portCAN, flags & ~TX_POOL_MASK);
+
+	/*Cycles the interrupts of the same level wait for this one*/
+	start = CAN_CycleCount() - start;
+	if (start > topHalfMax[CAN_INDEX(portCAN)])
+		topHalfMax[CAN_INDEX(portCAN)] = start;
+}
+
+/*RXIMR of a mask of standard ID, every bit outside of the ID is compared*/
+static uint32_t CAN_RxMaskWord(uint32_t mask)
+{
+	return (CHECK_ID & ~(CAN_EXACT_ID << SHIFT_STD_MASK)) | ((mask & CAN_EXACT_ID) << SHIFT_STD_MASK);
+}
+
+void CAN_SetRxMask(PortCAN_t portCAN, uint8_t mb, uint32_t mask)
+{
+	CAN_Type *base = CAN_INST(portCAN)->base;
+
+	if (mb >= CAN_INST(portCAN)->mbCount)
+		return;
+
+	/*The individual masks are only written in freeze mode*/
+	CAN_EnterFreeze(base);
+	base->RXIMR[mb] = CAN_RxMaskWord(mask);
+	CAN_ExitFreeze(base);
+}
+
+uint8_t CAN_AddRxFilter(PortCAN_t portCAN, const CAN_RxFilter_t* filter)
+{
+	CAN_Type *base = CAN_INST(portCAN)->base;
+	uint8_t mb = CAN_AllocMB(portCAN);
+
+	if (CAN_NO_MB == mb)
+		return CAN_NO_MB;
+
+	/*The MB does not match frames until the ID is written*/
+	base->RAMn[MB_WORD(mb)] = CODE_RX_INACTIVE;
+	base->RAMn[MB_WORD(mb) + 1] = filter->ID << SHIFT_STD_ID;
+	base->IFLAG1 = 1UL << mb;
+
+	/*The exact masks written by CAN_init do not need the freeze mode*/
+	if (base->RXIMR[mb] != CAN_RxMaskWord(filter->mask))
+		CAN_SetRxMask(portCAN, mb, filter->mask);
+
+	if (RX_LATEST == filter->delivery)
+	{
+		/*The controller overwrites the MB, no interrupt is needed*/
+		rxLatestMask[CAN_INDEX(portCAN)] |= 1UL << mb;
+	}
+	else
+	{
+		if (RX_SIGNAL == filter->delivery)
+		{
+			rxSignal[CAN_INDEX(portCAN)][mb].seq = 0;
+			rxSignalMask[CAN_INDEX(portCAN)] |= 1UL << mb;
+		}
+
+		base->IMASK1 |= 1UL << mb;
+		CAN_EnableIRQ((mb < MB_IRQ_SPLIT) ? CAN_INST(portCAN)->mbIrq : CAN_INST(portCAN)->mbIrqHigh);
+	}
+
+	base->RAMn[MB_WORD(mb)] = CODE_RX_EMPTY;
+
+	return mb;
+}
+
+void CAN_RemoveRxFilter(PortCAN_t portCAN, uint8_t mb)
+{
+	CAN_Type *base = CAN_INST(portCAN)->base;
+	uint32_t irqState;
+	uint32_t cs;
+	Rx_t frame;
+
+	irqState = CAN_EnterCritical();
+
+	/*Lock the MB, the frames of the ID go to the FIFO or are rejected from now on*/
+	cs = base->RAMn[MB_WORD(mb)];
+	base->IMASK1 &= ~(1UL << mb);
+	base->RAMn[MB_WORD(mb)] = CODE_RX_INACTIVE;
+
+	/*A frame moved in before the inactivation is still in the MB*/
+	if (base->IFLAG1 & (1UL << mb))
+	{
+		frame.RxCode     = CAN_RX_FULL;
+		frame.RxID       = (base->RAMn[MB_WORD(mb) + 1] & CAN_WMBn_ID_ID_MASK) >> SHIFT_STD_ID;
+		frame.RxLength   = (cs & CAN_WMBn_CS_DLC_MASK) >> CAN_WMBn_CS_DLC_SHIFT;
+		frame.RxRemote   = (cs & CAN_WMBn_CS_RTR_MASK) >> CAN_WMBn_CS_RTR_SHIFT;
+		frame.RxTimeStamp = cs & TIME_STAMP_RX;
+		frame.RxData[0]  = base->RAMn[MB_WORD(mb) + 2];
+		frame.RxData[1]  = base->RAMn[MB_WORD(mb) + 3];
+		frame.RxOwn      = CAN_IsOwnFrame(portCAN, base->RAMn[MB_WORD(mb) + 1], frame.RxTimeStamp);
+		base->IFLAG1 = 1UL << mb;
+
+		if (!(rxLatestMask[CAN_INDEX(portCAN)] & (1UL << mb)))
+			CAN_RxPush(portCAN, &frame);
+	}
+
+	/*Unlock message buffers*/
+	(void)CAN_GetTime(portCAN);
+
+	rxLatestMask[CAN_INDEX(portCAN)] &= ~(1UL << mb);
+	rxSignalMask[CAN_INDEX(portCAN)] &= ~(1UL << mb);
+	mbUsed[CAN_INDEX(portCAN)] &= ~(1UL << mb);
+
+	CAN_ExitCritical(irqState);
+}
+
+uint8_t CAN_EnableAdaptiveRx(PortCAN_t portCAN, uint8_t dedicatedMBs)
+{
+	CAN_Type *base = CAN_INST(portCAN)->base;
+	uint8_t counter;
+
+	/*The RX MB4 of CAN_Receiver is replaced by the FIFO*/
+	if (mbUsed[CAN_INDEX(portCAN)] & FIFO_MB_MASK & ~MB_USED_INIT)
+		return 0;
+
+	mbUsed[CAN_INDEX(portCAN)] |= FIFO_MB_MASK;
+
+	for (counter = 0; counter < HOT_TABLE_SIZE; counter++)
+	{
+		rxHot[CAN_INDEX(portCAN)][counter].ID = HOT_NO_ID;
+		rxHot[CAN_INDEX(portCAN)][counter].count = 0;
+		rxHot[CAN_INDEX(portCAN)][counter].mb = CAN_NO_MB;
+	}
+	rxHotLimit[CAN_INDEX(portCAN)] = dedicatedMBs;
+
+	CAN_EnterFreeze(base);
+
+	/*FIFO with 8 filters, the MBs are matched before the FIFO*/
+	base->MCR |= CAN_MCR_RFEN_MASK;
+	base->CTRL2 = (base->CTRL2 & ~CAN_CTRL2_RFFN_MASK) | CAN_CTRL2_MRP_MASK;
+
+	/*Every ID is accepted by the FIFO, the filters use the masks of MB0-MB7*/
+	for (counter = 0; counter < FIFO_FILTERS; counter++)
+	{
+		base->RAMn[MB_WORD(FIFO_FILTER_MB) + counter] = 0;
+		base->RXIMR[counter] = FIFO_ACCEPT_ALL;
+	}
+	base->RXFGMASK = FIFO_ACCEPT_ALL;
+
+	CAN_ExitFreeze(base);
+
+	rxAdaptive[CAN_INDEX(portCAN)] = 1;
+
+	/*Frames available and frames lost by the FIFO*/
+	base->IFLAG1 = FIFO_AVAILABLE | FIFO_WARNING | FIFO_OVERFLOW;
+	base->IMASK1 |= FIFO_AVAILABLE | FIFO_OVERFLOW;
+	CAN_EnableIRQ(CAN_INST(portCAN)->mbIrq);
+
+	return 1;
+}
+
+void CAN_AdaptiveService(PortCAN_t portCAN)
+{
+	HotID_t *hot = rxHot[CAN_INDEX(portCAN)];
+	CAN_RxFilter_t filter;
+	uint32_t hottest = 0;
+	uint32_t irqState;
+	uint8_t rank;
+	uint8_t entry;
+	uint8_t best;
+
+	if (!rxAdaptive[CAN_INDEX(portCAN)])
+		return;
+
+	irqState = CAN_EnterCritical();
+
+	/*Mark the hottest IDs, the promoted ones win the ties*/
+	for (rank = 0; rank < rxHotLimit[CAN_INDEX(portCAN)]; rank++)
+	{
+		best = HOT_TABLE_SIZE;
+		for (entry = 0; entry < HOT_TABLE_SIZE; entry++)
+		{
+			if ((hottest & (1UL << entry)) || (0 == hot[entry].count))
+				continue;
+
+			if ((HOT_TABLE_SIZE == best) || (hot[entry].count > hot[best].count) ||
+				((hot[entry].count == hot[best].count) && (CAN_NO_MB != hot[entry].mb)))
+				best = entry;
+		}
+
+		if (HOT_TABLE_SIZE != best)
+			hottest |= 1UL << best;
+	}
+
+	/*Demote first to free the MBs*/
+	for (entry = 0; entry < HOT_TABLE_SIZE; entry++)
+	{
+		if ((CAN_NO_MB != hot[entry].mb) && !(hottest & (1UL << entry)))
+		{
+			CAN_RemoveRxFilter(portCAN, hot[entry].mb);
+			hot[entry].mb = CAN_NO_MB;
+		}
+	}
+
+	/*The MB takes the ID before the FIFO, the frames already in the FIFO are read first*/
+	filter.delivery = RX_QUEUED;
+	filter.mask = CAN_EXACT_ID;
+	for (entry = 0; entry < HOT_TABLE_SIZE; entry++)
+	{
+		if ((CAN_NO_MB == hot[entry].mb) && (hottest & (1UL << entry)))
+		{
+			filter.ID = hot[entry].ID;
+			hot[entry].mb = CAN_AddRxFilter(portCAN, &filter);
+		}
+
+		/*Older traffic weighs less on every service*/
+		hot[entry].count >>= 1;
+	}
+
+	CAN_ExitCritical(irqState);
+}
+
+/*Flag of the FIFO that raises the interrupt*/
+static uint32_t CAN_FifoIrqMask(PortCAN_t portCAN)
+{
+	return rxCoalesce[CAN_INDEX(portCAN)] ? FIFO_WARNING : FIFO_AVAILABLE;
+}
+
+uint8_t CAN_SetRxCoalescing(PortCAN_t portCAN, uint8_t enable)
+{
+	CAN_Type *base = CAN_INST(portCAN)->base;
+	uint32_t irqState;
+
+	if (!rxAdaptive[CAN_INDEX(portCAN)])
+		return 0;
+
+	irqState = CAN_EnterCritical();
+	rxCoalesce[CAN_INDEX(portCAN)] = enable ? 1 : 0;
+	if (!rxNapiPolling[CAN_INDEX(portCAN)])
+		base->IMASK1 = (base->IMASK1 & ~(FIFO_AVAILABLE | FIFO_WARNING)) | CAN_FifoIrqMask(portCAN);
+	CAN_ExitCritical(irqState);
+
+	return 1;
+}
+
+uint32_t CAN_RxPoll(PortCAN_t portCAN)
+{
+	uint32_t irqState;
+	uint32_t moved;
+
+	if (!rxAdaptive[CAN_INDEX(portCAN)])
+		return 0;
+
+	/*The FIFO interrupt drains the same FIFO*/
+	irqState = CAN_EnterCritical();
+	rxIrqStats[CAN_INDEX(portCAN)].polls++;
+	moved = CAN_FifoComplete(portCAN, FIFO_DRAIN);
+	CAN_ExitCritical(irqState);
+
+	return moved;
+}
+
+void CAN_GetRxIrqStats(PortCAN_t portCAN, CAN_RxIrqStats_t* stats)
+{
+	uint32_t irqState;
+
+	irqState = CAN_EnterCritical();
+	*stats = rxIrqStats[CAN_INDEX(portCAN)];
+	CAN_ExitCritical(irqState);
+}
+
+uint8_t CAN_EnableRxNapi(PortCAN_t portCAN, const CAN_RxNapi_t* napi)
+{
+	CAN_Type *base = CAN_INST(portCAN)->base;
+	uint32_t irqState;
+	uint32_t now;
+
+	if (!rxAdaptive[CAN_INDEX(portCAN)])
+		return 0;
+
+	now = CAN_GetTime(portCAN);
+
+	irqState = CAN_EnterCritical();
+	if (NULL != napi)
+		rxNapi[CAN_INDEX(portCAN)] = *napi;
+	else
+		rxNapi[CAN_INDEX(portCAN)].burstFrames = 0;
+
+	/*Back to the interrupt, the next burst is counted from now*/
+	if (rxNapiPolling[CAN_INDEX(portCAN)])
+		rxNapiStats[CAN_INDEX(portCAN)].timePolling += now - rxNapiSince[CAN_INDEX(portCAN)];
+	else
+		rxNapiStats[CAN_INDEX(portCAN)].timeInterrupt += now - rxNapiSince[CAN_INDEX(portCAN)];
+	rxNapiPolling[CAN_INDEX(portCAN)] = 0;
+	rxNapiSince[CAN_INDEX(portCAN)] = now;
+	rxNapiWindow[CAN_INDEX(portCAN)] = now;
+	rxNapiFrames[CAN_INDEX(portCAN)] = 0;
+	base->IMASK1 |= CAN_FifoIrqMask(portCAN);
+	CAN_ExitCritical(irqState);
+
+	return 1;
+}
+
+uint32_t CAN_RxNapiPoll(PortCAN_t portCAN)
+{
+	CAN_Type *base = CAN_INST(portCAN)->base;
+	uint32_t irqState;
+	uint32_t moved;
+	uint32_t now;
+
+	if (!rxNapiPolling[CAN_INDEX(portCAN)])
+		return 0;
+
+	irqState = CAN_EnterCritical();
+	moved = CAN_FifoComplete(portCAN, rxNapi[CAN_INDEX(portCAN)].budget);
+	rxNapiStats[CAN_INDEX(portCAN)].polled += moved;
+
+	/*A frame arriving after the check keeps its flag and interrupts at once*/
+	if (!(base->IFLAG1 & FIFO_AVAILABLE))
+	{
+		now = CAN_GetTime(portCAN);
+		rxNapiStats[CAN_INDEX(portCAN)].timePolling += now - rxNapiSince[CAN_INDEX(portCAN)];
+		rxNapiStats[CAN_INDEX(portCAN)].toInterrupt++;
+		rxNapiSince[CAN_INDEX(portCAN)] = now;
+		rxNapiWindow[CAN_INDEX(portCAN)] = now;
+		rxNapiFrames[CAN_INDEX(portCAN)] = 0;
+		rxNapiPolling[CAN_INDEX(portCAN)] = 0;
+		base->IMASK1 |= CAN_FifoIrqMask(portCAN);
 	}
+	CAN_ExitCritical(irqState);
+
+	return moved;
+}
+
+void CAN_GetRxNapiStats(PortCAN_t portCAN, CAN_RxNapiStats_t* stats)
+{
+	uint32_t irqState;
+	uint32_t now;
+
+	now = CAN_GetTime(portCAN);
+
+	/*The time of the current mode is counted up to now*/
+	irqState = CAN_EnterCritical();
+	*stats = rxNapiStats[CAN_INDEX(portCAN)];
+	if (rxNapiPolling[CAN_INDEX(portCAN)])
+		stats->timePolling += now - rxNapiSince[CAN_INDEX(portCAN)];
+	else if (rxNapi[CAN_INDEX(portCAN)].burstFrames)
+		stats->timeInterrupt += now - rxNapiSince[CAN_INDEX(portCAN)];
+	CAN_ExitCritical(irqState);
+}
+
+uint8_t CAN_SetDeferred(PortCAN_t portCAN, uint8_t enable)
+{
+	uint32_t irqState;
+
+	if (CAN_DEFER_FULL == deferId)
+		deferId = CAN_DeferRegister(CAN_BottomHalf);
+	if (CAN_DEFER_FULL == deferId)
+		return 0;
+
+	/*The events already queued are still run by the bottom half*/
+	irqState = CAN_EnterCritical();
+	deferOn[CAN_INDEX(portCAN)] = enable ? 1 : 0;
+	CAN_ExitCritical(irqState);
+
+	return 1;
+}
+
+uint32_t CAN_GetTopHalfMax(PortCAN_t portCAN)
+{
+	return topHalfMax[CAN_INDEX(portCAN)];
+}
+
+uint32_t CAN_GetDeferLost(PortCAN_t portCAN)
+{
+	return deferLost[CAN_INDEX(portCAN)];
+}
+
+uint8_t CAN_Receive(PortCAN_t portCAN, Rx_t* frame)
+{
+	uint32_t tail = rxRingTail[CAN_INDEX(portCAN)];
+
+	if (tail == rxRingHead[CAN_INDEX(portCAN)])
+		return 0;
+
+	*frame = rxRing[CAN_INDEX(portCAN)][tail & (RX_RING_SIZE - 1)];
+
+	/*Free the entry once it is copied*/
+	rxRingTail[CAN_INDEX(portCAN)] = tail + 1;
+
+	return 1;
+}
+
+uint8_t CAN_ReadLatest(PortCAN_t portCAN, uint8_t mb, Rx_t* frame)
+{
+	uint32_t flag;
+
+	/*The flag stays set from the first frame after the previous read, it is tested with the MB locked*/
+	CAN_ReadRxMBFlag(portCAN, mb, frame, &flag);
+
+	return flag ? 1 : 0;
+}
+
+uint32_t CAN_ReadSignal(PortCAN_t portCAN, uint8_t mb, Rx_t* frame)
+{
+	Signal_t *signal = &rxSignal[CAN_INDEX(portCAN)][mb];
+	uint32_t seq;
+
+	do
+	{
+		/*Wait for the interrupt to finish the copy*/
+		do
+		{
+			seq = signal->seq;
+		} while (seq & 1);
+
+		CAN_MemoryBarrier();
+		*frame = signal->value;
+		CAN_MemoryBarrier();
+
+		/*The interrupt updated the value during the copy*/
+	} while (seq != signal->seq);
+
+	return seq;
+}
+
+uint32_t CAN_GetOverrunCount(PortCAN_t portCAN, uint8_t mb)
+{
+	return rxOverrun[CAN_INDEX(portCAN)][mb];
+}
+
+uint32_t CAN_GetPortOverrunCount(PortCAN_t portCAN)
+{
+	return rxPortOverrun[CAN_INDEX(portCAN)];
+}
+
+void CAN_ReportOverrun(PortCAN_t portCAN, uint8_t mb)
+{
+	rxOverrun[CAN_INDEX(portCAN)][mb]++;
+	rxPortOverrun[CAN_INDEX(portCAN)]++;
+
+	if (NULL != rxOverrunCallback[CAN_INDEX(portCAN)])
+		rxOverrunCallback[CAN_INDEX(portCAN)](portCAN, mb);
+}
+
+uint32_t CAN_GetRxBacklog(PortCAN_t portCAN)
+{
+	return rxRingHead[CAN_INDEX(portCAN)] - rxRingTail[CAN_INDEX(portCAN)];
+}
+
+uint32_t CAN_GetRxLost(PortCAN_t portCAN)
+{
+	return rxRingLost[CAN_INDEX(portCAN)];
+}
+
+void CAN_SetBusMonitor(PortCAN_t portCAN, CAN_BusMonitor_t monitor)
+{
+	busMonitor[CAN_INDEX(portCAN)] = monitor;
+}
+
+void CAN_SetRxHook(PortCAN_t portCAN, CAN_RxHook_t hook)
+{
+	rxHook[CAN_INDEX(portCAN)] = hook;
+}
+
+void CAN_SetOverrunCallback(PortCAN_t portCAN, CAN_OverrunCallback_t callback)
+{
+	rxOverrunCallback[CAN_INDEX(portCAN)] = callback;
+}
+
+/*Message buffers of each port, MB16-31 only exist in CAN0*/
+#if CAN_PORT_USED(0)
+void CAN0_ORed_0_15_MB_IRQHandler(void)
+{
+	CAN_MBHandler(CAN_0);
+}
+
+void CAN0_ORed_16_31_MB_IRQHandler(void)
+{
+	CAN_MBHandler(CAN_0);
+}
+
+/*Bus errors of each port*/
+void CAN0_Error_IRQHandler(void)
+{
+	CAN_ErrorHandler(CAN_0);
+}
+#endif
+
+#if CAN_PORT_USED(1)
+void CAN1_ORed_0_15_MB_IRQHandler(void)
+{
+	CAN_MBHandler(CAN_1);
+}
+
+void CAN1_Error_IRQHandler(void)
+{
+	CAN_ErrorHandler(CAN_1);
+}
+#endif
+
+#if CAN_PORT_USED(2)
+void CAN2_ORed_0_15_MB_IRQHandler(void)
+{
+	CAN_MBHandler(CAN_2);
+}
+
+void CAN2_Error_IRQHandler(void)
+{
+	CAN_ErrorHandler(CAN_2);
 }
+#endif
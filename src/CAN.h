@@ -14,14 +14,27 @@
 #ifndef CAN_H_
 #define CAN_H_
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #define SBC_MC33903 	/*Transceiver CAN*/
 
+/*Build the driver for one port (0, 1 or 2), the port argument is ignored*/
+/*#define CAN_FIXED_PORT	(0)*/
+
 /*Port CAN*/
 typedef enum {CAN_0, CAN_1, CAN_2} PortCAN_t;
 
 /*Clock source variable*/
 typedef enum {OSCILLATOR_SRC, PERIPHERAL_SRC} clkSource_t;
 
+/*Handling of the remote requests received*/
+typedef enum {REMOTE_ANSWER, REMOTE_STORE} remoteRequest_t;
+
+/*Reception of the frames sent by the port*/
+typedef enum {SELF_RX_TAG, SELF_RX_OFF} selfReception_t;
+
 /*Time of the frame*/
 typedef enum
 {
@@ -49,8 +62,14 @@ typedef struct
 	bitTime_t	bitTime;		/*Bit time of CAN frame*/
 	clkSource_t clkSource;		/*Source clock*/
 	Timing_t	timing;			/*Timing to CAN bus*/
+	remoteRequest_t	remoteRequest;	/*Answered by the response MBs or stored in the RX MBs*/
+	selfReception_t	selfReception;	/*Own frames received with RxOwn set or not received*/
 } CAN_Config_t;
 
+/*Codes of a RX message buffer with a frame, RxCode*/
+#define CAN_RX_FULL			(0x2)	/*Frame received*/
+#define CAN_RX_OVERRUN		(0x6)	/*Frame received, the previous one was lost*/
+
 /*Variables needed to Rx*/
 typedef struct
 {
@@ -59,8 +78,159 @@ typedef struct
 	uint32_t  RxLength;            /* Received message number of data bytes */
 	uint32_t  RxData[2];           /* Received message data */
 	uint32_t  RxTimeStamp;         /* Received message time */
+	uint32_t  RxRemote;            /* Received message is a remote request */
+	uint32_t  RxOwn;               /* Received message was sent by this port */
 } Rx_t;
 
+/*Handle returned when every message buffer of the TX pool is busy*/
+#define CAN_TX_POOL_FULL	(0xFF)
+
+/*Answers of the admission check of CAN_Send, the held frames return them as handle*/
+#define CAN_TX_ADMITTED		(0x00)	/*Frame goes to the TX pool*/
+#define CAN_TX_DROPPED		(0xFE)	/*Frame discarded*/
+#define CAN_TX_DEFERRED		(0xFD)	/*Frame kept by the check to be sent later*/
+
+/*Message buffer returned when every message buffer of the port is used*/
+#define CAN_NO_MB			(0xFF)
+
+/*Message buffers kept by the driver, MB4 receives for CAN_Receiver*/
+#define CAN_TX_POOL_FIRST	(8)		/*First message buffer of the TX pool*/
+#define CAN_TX_POOL_SIZE	(4)		/*Message buffers of the TX pool*/
+#define CAN_FIFO_MBS		(8)		/*MB0-MB7 taken by the RX FIFO of the adaptive mode*/
+
+/*Retransmission policy of a frame*/
+typedef enum {TX_RETRY, TX_ONE_SHOT} CAN_TxMode_t;
+
+/*Status of a frame handed to the TX pool*/
+typedef enum
+{
+	TX_IDLE,			/*Message buffer never used*/
+	TX_PENDING,			/*Frame waiting for the bus*/
+	TX_ABORTING,		/*Abort requested, waiting for the controller*/
+	TX_DONE,			/*Frame sent and acknowledged*/
+	TX_TIMEOUT,			/*Deadline elapsed, frame aborted or remote request not answered*/
+	TX_FAILED			/*One-shot frame aborted after a bus error*/
+} CAN_TxStatus_t;
+
+/*Frame to transmit*/
+typedef struct
+{
+	uint32_t	ID;				/*Standard identifier*/
+	uint32_t	Length;			/*Number of data bytes*/
+	uint32_t	Data[2];		/*Data words*/
+	uint8_t		Remote;			/*1 for a remote request, Length is the length requested, the answer goes to the RX ring.
+								  The MB is held until the answer, TX_TIMEOUT at the deadline without answer (give it a timeout)*/
+} CAN_Frame_t;
+
+/*Options of one transmission*/
+typedef struct
+{
+	uint32_t		timeout;	/*Deadline in bit times from the submission, 0 waits forever*/
+	CAN_TxMode_t	mode;		/*Retransmission policy*/
+	uint32_t		tag;		/*User tag reported with the confirmation*/
+} CAN_TxOptions_t;
+
+/*Confirmation of a finished frame*/
+typedef struct
+{
+	uint32_t		tag;		/*User tag given in the options*/
+	void			*context;	/*Context given to CAN_SendAsync, NULL for CAN_Send*/
+	CAN_TxStatus_t	status;		/*Final status of the frame*/
+	uint32_t		timeStamp;	/*Monotonic time the frame was sent, 0 when not sent*/
+} CAN_TxConfirm_t;
+
+/*Mask of an accepted ID comparing all the bits*/
+#define CAN_EXACT_ID		(0x7FF)
+
+/*Delivery of the frames of an accepted ID*/
+typedef enum
+{
+	RX_QUEUED,			/*Every frame goes to the RX ring*/
+	RX_LATEST,			/*Only the newest frame is kept in its message buffer*/
+	RX_SIGNAL			/*The interrupt keeps the newest frame in the signal store*/
+} CAN_RxDelivery_t;
+
+/*Accepted ID*/
+typedef struct
+{
+	uint32_t			ID;			/*Standard identifier*/
+	uint32_t			mask;		/*Bits of the ID compared, CAN_EXACT_ID for one ID*/
+	CAN_RxDelivery_t	delivery;	/*Queued or latest value*/
+} CAN_RxFilter_t;
+
+/*Called when a RX message buffer lost a frame before it was read*/
+typedef void (*CAN_OverrunCallback_t)(PortCAN_t portCAN, uint8_t mb);
+
+/*Called by the RX interrupt with each queued frame, 1 keeps the frame out of the RX ring*/
+typedef uint8_t (*CAN_RxHook_t)(PortCAN_t portCAN, const Rx_t* frame);
+
+/*Called from the interrupts with each frame received or sent and its monotonic time*/
+typedef void (*CAN_BusMonitor_t)(PortCAN_t portCAN, const CAN_Frame_t* frame, uint32_t timeStamp);
+
+/*Called with the final status of each frame of the TX pool*/
+typedef void (*CAN_TxCallback_t)(PortCAN_t portCAN, uint8_t handle, CAN_TxStatus_t status);
+
+/*Work of the RX FIFO of a port*/
+typedef struct
+{
+	uint32_t	interrupts;		/*Interrupts that drained the FIFO*/
+	uint32_t	polls;			/*Calls of CAN_RxPoll*/
+	uint32_t	frames;			/*Frames taken from the FIFO*/
+} CAN_RxIrqStats_t;
+
+/*Switch of the RX FIFO from one interrupt per frame to polling*/
+typedef struct
+{
+	uint32_t	burstFrames;	/*Frames in the window that mask the interrupt, 0 disables*/
+	uint32_t	burstWindow;	/*Bit times of the window*/
+	uint32_t	budget;			/*Frames moved by each CAN_RxNapiPoll*/
+} CAN_RxNapi_t;
+
+/*Modes of the RX FIFO of a port, the times are in bit times*/
+typedef struct
+{
+	uint32_t	toPolling;		/*Bursts that masked the interrupt*/
+	uint32_t	toInterrupt;	/*Polls that found the FIFO empty and unmasked it*/
+	uint32_t	polled;			/*Frames moved by CAN_RxNapiPoll*/
+	uint32_t	timeInterrupt;	/*Time with the FIFO interrupt enabled*/
+	uint32_t	timePolling;	/*Time with the FIFO left to the polls*/
+} CAN_RxNapiStats_t;
+
+/*Completion of a frame of CAN_SendAsync, called by the TX interrupt (or its bottom half)*/
+typedef void (*CAN_TxDone_t)(PortCAN_t portCAN, void* context, CAN_TxStatus_t status, uint32_t timeStamp);
+
+/*Called by CAN_Send and CAN_SendAsync before the TX pool with the completion of the frame (NULL for
+  CAN_Send), returns CAN_TX_ADMITTED, CAN_TX_DROPPED or CAN_TX_DEFERRED*/
+typedef uint8_t (*CAN_TxAdmit_t)(PortCAN_t portCAN, const CAN_Frame_t* frame, const CAN_TxOptions_t* options,
+		CAN_TxDone_t done, void* context);
+
+/*Cost of the TX completions of a port in core cycles, the callbacks are not counted*/
+typedef struct
+{
+	uint32_t	completions;	/*Frames finished*/
+	uint64_t	cycles;			/*Cycles of all the completions*/
+	uint32_t	cyclesMax;		/*Longest completion*/
+} CAN_TxDoneStats_t;
+
+/*Called by the TX interrupt after it released MBs of the TX pool*/
+typedef void (*CAN_TxRefill_t)(PortCAN_t portCAN);
+
+/*Message buffer loaded by CAN_ArmTx, the frame is launched by one write*/
+typedef struct
+{
+	volatile uint32_t	*cs;	/*Control and Status word of the MB*/
+	uint32_t			code;	/*Word that starts the transmission*/
+	PortCAN_t			port;
+	uint8_t				mb;
+} CAN_TxTrigger_t;
+
+#define CAN_TX_CODE_MASK	(0x0F000000)	/*Code field of the CS word*/
+#define CAN_TX_CODE_IDLE	(0x08000000)	/*Code of an armed MB ready to be fired*/
+#define CAN_TX_STAMP_MASK	(0x0000FFFF)	/*Time stamp of the last frame sent in the CS word*/
+
+/*Launch an armed frame, the code of the MB must be CAN_TX_CODE_IDLE*/
+#define CAN_FireTx(trigger)		(*(trigger)->cs = (trigger)->code)
+
 /********************************************************************************************/
 /********************************************************************************************/
 /********************************************************************************************/
@@ -82,6 +252,157 @@ void CAN_init(PortCAN_t portCAN, const CAN_Config_t* CAN_Config);
  */
 void CAN_Transmitter(PortCAN_t portCAN, uint32_t dataWord1, uint32_t dataWord2);
 
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Queue a frame in a free message buffer of the TX pool, the frame
+ 	 	 	 	is aborted when its deadline elapses or, in one-shot mode, on
+ 	 	 	 	the first bus error of its own transmission
+ 	 \param[in]	CAN Port, frame and options (NULL retries forever)
+ 	 \return	Handle of the frame, CAN_TX_POOL_FULL or the answer of the
+ 	 	 	 	admission check that held the frame
+ */
+uint8_t CAN_Send(PortCAN_t portCAN, const CAN_Frame_t* frame, const CAN_TxOptions_t* options);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Status of a frame, kept until its message buffer is reused
+ 	 \param[in]	CAN Port and handle returned by CAN_Send
+ 	 \return	Status of the frame
+ */
+CAN_TxStatus_t CAN_GetTxStatus(PortCAN_t portCAN, uint8_t handle);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Collect the finished frames and abort the expired ones, it must
+ 	 	 	 	be called periodically (main loop or timer) and at least once
+ 	 	 	 	every 65536 bit times
+ 	 \param[in]	CAN Port
+ 	 \return	Void
+ */
+void CAN_TxService(PortCAN_t portCAN);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Report the finished frames from the TX interrupt, NULL goes
+ 	 	 	 	back to the polled status
+ 	 \param[in]	CAN Port and callback
+ 	 \return	Void
+ */
+void CAN_SetTxCallback(PortCAN_t portCAN, CAN_TxCallback_t callback);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Monotonic time a frame was sent, written before the TX
+ 	 	 	 	callback is called
+ 	 \param[in]	CAN Port and handle returned by CAN_Send
+ 	 \return	Time in bit times, 0 when the frame was not sent
+ */
+uint32_t CAN_GetTxTime(PortCAN_t portCAN, uint8_t handle);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Check every frame given to CAN_Send or CAN_SendAsync before
+ 	 	 	 	the TX pool, NULL sends every frame. A deferred frame is
+ 	 	 	 	sent later with its completion and context
+ 	 \param[in]	CAN Port and admission check
+ 	 \return	Void
+ */
+void CAN_SetTxAdmit(PortCAN_t portCAN, CAN_TxAdmit_t admit);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	CAN_Send with a context reported when the frame is finished.
+ 	 	 	 	With done the completion is called from the TX interrupt,
+ 	 	 	 	without it the confirmation with the context is queued for
+ 	 	 	 	CAN_GetTxConfirm. The TX interrupt is enabled from the first
+ 	 	 	 	call. Frames deferred by the admission check keep the
+ 	 	 	 	completion and the context
+ 	 \param[in]	CAN Port, frame, options (NULL for the defaults), completion and context
+ 	 \return	Handle of the TX pool, CAN_TX_POOL_FULL or the answer of the admission check
+ */
+uint8_t CAN_SendAsync(PortCAN_t portCAN, const CAN_Frame_t* frame, const CAN_TxOptions_t* options,
+		CAN_TxDone_t done, void* context);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Completions of a port and their cost in core cycles, measured
+ 	 	 	 	with the DWT started by CAN_DeferInit
+ 	 \param[in]	CAN Port and structure where the counters are saved
+ 	 \return	Void
+ */
+void CAN_GetTxDoneStats(PortCAN_t portCAN, CAN_TxDoneStats_t* stats);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Call a function from the TX interrupt each time MBs of the
+ 	 	 	 	pool are released, it can give them new frames with
+ 	 	 	 	CAN_Send. The TX interrupt stays enabled while it is set
+ 	 \param[in]	CAN Port and refill function, NULL removes it
+ 	 \return	Void
+ */
+void CAN_SetTxRefill(PortCAN_t portCAN, CAN_TxRefill_t refill);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Reserve a message buffer that answers by hardware the remote
+ 	 	 	 	requests of the ID of the response, needs REMOTE_ANSWER
+ 	 \param[in]	CAN Port and response frame
+ 	 \return	Message buffer of the response or CAN_NO_MB
+ */
+uint8_t CAN_AddRemoteResponse(PortCAN_t portCAN, const CAN_Frame_t* response);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Change the data answered by a response message buffer
+ 	 \param[in]	CAN Port, message buffer of the response and response frame
+ 	 \return	Void
+ */
+void CAN_UpdateRemoteResponse(PortCAN_t portCAN, uint8_t mb, const CAN_Frame_t* response);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Take the confirmations of the finished frames in the order
+ 	 	 	 	they finished
+ 	 \param[in]	CAN Port, buffer for the confirmations and its length
+ 	 \return	Number of confirmations copied
+ */
+uint32_t CAN_GetTxConfirm(PortCAN_t portCAN, CAN_TxConfirm_t* confirm, uint32_t max);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Monotonic time of the port, free running timer of FlexCAN
+ 	 	 	 	extended to 32 bits
+ 	 \param[in]	CAN Port
+ 	 \return	Time in bit times
+ */
+uint32_t CAN_GetTime(PortCAN_t portCAN);
+
 /********************************************************************************************/
 /********************************************************************************************/
 /********************************************************************************************/
@@ -92,4 +413,322 @@ void CAN_Transmitter(PortCAN_t portCAN, uint32_t dataWord1, uint32_t dataWord2);
  */
 void CAN_Receiver(PortCAN_t portCAN, uint32_t *data1, uint32_t *data2);
 
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Accept an ID or a range of IDs in its own message buffer, the
+ 	 	 	 	queued IDs are moved to the RX ring by the interrupt and the
+ 	 	 	 	latest values stay in the message buffer until read. A mask
+ 	 	 	 	other than CAN_EXACT_ID freezes the module while it is written
+ 	 \param[in] CAN Port and accepted ID
+ 	 \return 	Message buffer of the ID or CAN_NO_MB
+ */
+uint8_t CAN_AddRxFilter(PortCAN_t portCAN, const CAN_RxFilter_t* filter);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Individual mask of a RX message buffer, the module is frozen
+ 	 	 	 	while the mask is written so it is meant for the start up
+ 	 \param[in] CAN Port, message buffer of the port and bits of the
+ 	 	 	 	standard ID compared
+ 	 \return 	Void
+ */
+void CAN_SetRxMask(PortCAN_t portCAN, uint8_t mb, uint32_t mask);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Release the message buffer of an accepted ID, a frame still
+ 	 	 	 	in it is moved to the RX ring
+ 	 \param[in] CAN Port and message buffer returned by CAN_AddRxFilter
+ 	 \return 	Void
+ */
+void CAN_RemoveRxFilter(PortCAN_t portCAN, uint8_t mb);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Receive every ID in the RX FIFO (MB0-MB7) and promote the most
+ 	 	 	 	frequent IDs to dedicated message buffers, the message
+ 	 	 	 	buffers are matched before the FIFO so a promotion does not
+ 	 	 	 	lose frames. Frames of both paths go to the RX ring
+ 	 \param[in] CAN Port and number of message buffers for promoted IDs
+ 	 \return 	1 when enabled, 0 when MB0-MB7 are used by other filters
+ */
+uint8_t CAN_EnableAdaptiveRx(PortCAN_t portCAN, uint8_t dedicatedMBs);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Promote the hottest IDs and demote the ones that cooled down,
+ 	 	 	 	it must be called periodically (main loop or timer), the
+ 	 	 	 	period sets how fast the driver follows the traffic
+ 	 \param[in] CAN Port
+ 	 \return 	Void
+ */
+void CAN_AdaptiveService(PortCAN_t portCAN);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Interrupt of the RX FIFO on every frame or only when it
+ 	 	 	 	holds 5 frames (the watermark of the hardware). With the
+ 	 	 	 	watermark CAN_RxPoll must be called from a timer, its period
+ 	 	 	 	is the longest delay added to a frame
+ 	 \param[in] CAN Port and 1 for the watermark, 0 for every frame
+ 	 \return 	1 when set, 0 when the FIFO is not enabled
+ */
+uint8_t CAN_SetRxCoalescing(PortCAN_t portCAN, uint8_t enable);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Move the frames of the RX FIFO to the RX ring outside of the
+ 	 	 	 	interrupt of the port
+ 	 \param[in] CAN Port
+ 	 \return 	Frames moved
+ */
+uint32_t CAN_RxPoll(PortCAN_t portCAN);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Interrupts, polls and frames of the RX FIFO of a port
+ 	 \param[in] CAN Port and structure where the counters are saved
+ 	 \return 	Void
+ */
+void CAN_GetRxIrqStats(PortCAN_t portCAN, CAN_RxIrqStats_t* stats);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Take the RX FIFO away from its interrupt during bursts. The
+ 	 	 	 	interrupt that completes burstFrames inside the window masks
+ 	 	 	 	the FIFO, CAN_RxNapiPoll moves the frames until the FIFO is
+ 	 	 	 	empty and unmasks it again
+ 	 \param[in] CAN Port and thresholds, NULL disables the switch
+ 	 \return 	1 when set, 0 when the FIFO is not enabled
+ */
+uint8_t CAN_EnableRxNapi(PortCAN_t portCAN, const CAN_RxNapi_t* napi);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Bottom half of a masked RX FIFO, called from the main loop
+ 	 	 	 	(CAN_ServicePoll calls it). Does nothing while the interrupt
+ 	 	 	 	takes the frames
+ 	 \param[in] CAN Port
+ 	 \return 	Frames moved to the RX ring
+ */
+uint32_t CAN_RxNapiPoll(PortCAN_t portCAN);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Mode switches and time spent in each mode of the RX FIFO
+ 	 \param[in] CAN Port and structure where the counters are saved
+ 	 \return 	Void
+ */
+void CAN_GetRxNapiStats(PortCAN_t portCAN, CAN_RxNapiStats_t* stats);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Move the RX hook, the bus monitor and the TX callback of a
+ 	 	 	 	port out of its interrupts. The interrupts only copy the
+ 	 	 	 	frames and clear the flags, the handlers run from PendSV in
+ 	 	 	 	the same order. CAN_DeferInit must be called before
+ 	 \param[in] CAN Port and 1 to defer, 0 to run the handlers in the interrupts
+ 	 \return 	1 when set, 0 when the bottom half can not be registered
+ */
+uint8_t CAN_SetDeferred(PortCAN_t portCAN, uint8_t enable);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Longest MB interrupt of a port in core cycles, measured with
+ 	 	 	 	the DWT started by CAN_DeferInit
+ 	 \param[in] CAN Port
+ 	 \return 	Cycles
+ */
+uint32_t CAN_GetTopHalfMax(PortCAN_t portCAN);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Handler calls lost because the queue of the bottom half was full
+ 	 \param[in] CAN Port
+ 	 \return 	Events lost
+ */
+uint32_t CAN_GetDeferLost(PortCAN_t portCAN);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Take the oldest frame of the RX ring
+ 	 \param[in] CAN Port and frame where the data received is saved
+ 	 \return 	1 when a frame was taken, 0 when the ring is empty
+ */
+uint8_t CAN_Receive(PortCAN_t portCAN, Rx_t* frame);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Read the latest value of a RX_LATEST message buffer, the
+ 	 	 	 	frame is read with the message buffer locked
+ 	 \param[in] CAN Port, message buffer and frame where the value is saved
+ 	 \return 	1 when the value is new since the previous read, 0 otherwise
+ */
+uint8_t CAN_ReadLatest(PortCAN_t portCAN, uint8_t mb, Rx_t* frame);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Read the newest frame of a RX_SIGNAL message buffer without
+ 	 	 	 	masking interrupts, the read is retried when the interrupt
+ 	 	 	 	updates the value in the middle
+ 	 \param[in] CAN Port, message buffer and frame where the value is saved
+ 	 \return 	Sequence of the value, it changes on every update, 0 before
+ 	 	 	 	the first frame
+ */
+uint32_t CAN_ReadSignal(PortCAN_t portCAN, uint8_t mb, Rx_t* frame);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Frames lost by overrun in a RX message buffer
+ 	 \param[in] CAN Port and message buffer
+ 	 \return 	Number of frames lost
+ */
+uint32_t CAN_GetOverrunCount(PortCAN_t portCAN, uint8_t mb);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Frames lost by overrun in all the RX message buffers of a port
+ 	 \param[in] CAN Port
+ 	 \return 	Number of frames lost
+ */
+uint32_t CAN_GetPortOverrunCount(PortCAN_t portCAN);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Count a frame lost by a message buffer read outside of the
+ 	 	 	 	driver (OVERRUN code) and call the overrun callback
+ 	 \param[in] CAN Port and message buffer
+ 	 \return 	Void
+ */
+void CAN_ReportOverrun(PortCAN_t portCAN, uint8_t mb);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Report each overrun when it is read, NULL only counts them
+ 	 \param[in] CAN Port and callback
+ 	 \return 	Void
+ */
+void CAN_SetOverrunCallback(PortCAN_t portCAN, CAN_OverrunCallback_t callback);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Frames waiting in the RX ring
+ 	 \param[in] CAN Port
+ 	 \return 	Number of frames
+ */
+uint32_t CAN_GetRxBacklog(PortCAN_t portCAN);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Frames dropped because the RX ring was full
+ 	 \param[in] CAN Port
+ 	 \return 	Number of frames lost
+ */
+uint32_t CAN_GetRxLost(PortCAN_t portCAN);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Give the queued frames to a hook in the RX interrupt before
+ 	 	 	 	the RX ring, NULL queues every frame
+ 	 \param[in] CAN Port and hook
+ 	 \return 	Void
+ */
+void CAN_SetRxHook(PortCAN_t portCAN, CAN_RxHook_t hook);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Report every frame read from a RX message buffer or the FIFO
+ 	 	 	 	and every frame sent by the TX pool, NULL stops the reports
+ 	 \param[in] CAN Port and monitor
+ 	 \return 	Void
+ */
+void CAN_SetBusMonitor(PortCAN_t portCAN, CAN_BusMonitor_t monitor);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Take a given message buffer away from the driver, the
+ 	 	 	 	application drives it through the registers
+ 	 \param[in] CAN Port and message buffer
+ 	 \return 	1 when taken, 0 when the message buffer is already used
+ */
+uint8_t CAN_ClaimMB(PortCAN_t portCAN, uint8_t mb);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Take a message buffer and load a frame in it as inactive,
+ 	 	 	 	CAN_FireTx sends it with a single write of the code. The MB
+ 	 	 	 	goes back to inactive after each frame and can be fired again
+ 	 \param[in] CAN Port, frame and trigger filled for CAN_FireTx
+ 	 \return 	MB used, CAN_NO_MB when there is no free message buffer
+ */
+uint8_t CAN_ArmTx(PortCAN_t portCAN, const CAN_Frame_t* frame, CAN_TxTrigger_t* trigger);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Replace the data of an armed frame between two launches
+ 	 \param[in] Trigger of CAN_ArmTx and data words
+ 	 \return 	1 when written, 0 while the previous frame is pending
+ */
+uint8_t CAN_UpdateArmedTx(const CAN_TxTrigger_t* trigger, uint32_t dataWord1, uint32_t dataWord2);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* CAN_H_ */
@@ -0,0 +1,218 @@
+/**
+ *	\file	CAN_BusLoad.c
+ *	\brief
+ *			Stuffed length of the frames and sliding window of the load
+ *			of each port.
+ */
+
+#include "S32K144.h"
+#include "CAN.h"
+#include "CAN_Critical.h"
+#include "CAN_BusLoad.h"
+
+#define STUFF_STATES		(10)			/*Value of the last bit and equal bits before*/
+#define STUFF_IDLE			(5)				/*State before the SOF*/
+#define FRAME_TAIL_BITS		(13)			/*CRC and ACK delimiters, ACK slot, EOF and interframe space*/
+#define CRC_BITS			(15)			/*CRC of classic CAN*/
+#define CRC_MASK			(0x7FFF)
+#define CRC_POLY			(0x4599)		/*x^15 + x^14 + x^10 + x^8 + x^7 + x^4 + x^3 + 1*/
+#define CRC_TOP_SHIFT		(11)			/*Upper nibble of the CRC register*/
+#define MAX_DATA_BYTES		(8)				/*Data bytes of a classic frame*/
+#define SHIFT_EXT_ID		(18)			/*Bits of the extension of an extended ID*/
+#define LOAD_SCALE			(10000)			/*Hundredths of percent of a full bus*/
+
+/*CRC-15 (0x4599) of a nibble, the register is shifted 4 bits at once*/
+static const uint16_t crcNibble[16] =
+{
+	0x0000, 0x4599, 0x4EAB, 0x0B32, 0x58CF, 0x1D56, 0x1664, 0x53FD,
+	0x7407, 0x319E, 0x3AAC, 0x7F35, 0x2CC8, 0x6951, 0x6263, 0x27FA
+};
+
+/*
+ * Bit stuffing as a state machine, state = 5 * value of the last bit + equal bits
+ * before (0 only before the SOF). Each entry is (stuff bits << 4) | next state,
+ * a nibble holds at most one stuff bit.
+ */
+static const uint8_t stuffNibble[STUFF_STATES][16] =
+{
+	{0x04, 0x06, 0x01, 0x07, 0x02, 0x06, 0x01, 0x08, 0x03, 0x06, 0x01, 0x07, 0x02, 0x06, 0x01, 0x09},
+	{0x16, 0x06, 0x01, 0x07, 0x02, 0x06, 0x01, 0x08, 0x03, 0x06, 0x01, 0x07, 0x02, 0x06, 0x01, 0x09},
+	{0x11, 0x17, 0x01, 0x07, 0x02, 0x06, 0x01, 0x08, 0x03, 0x06, 0x01, 0x07, 0x02, 0x06, 0x01, 0x09},
+	{0x12, 0x16, 0x11, 0x18, 0x02, 0x06, 0x01, 0x08, 0x03, 0x06, 0x01, 0x07, 0x02, 0x06, 0x01, 0x09},
+	{0x13, 0x16, 0x11, 0x17, 0x12, 0x16, 0x11, 0x19, 0x03, 0x06, 0x01, 0x07, 0x02, 0x06, 0x01, 0x09},
+	{0x04, 0x06, 0x01, 0x07, 0x02, 0x06, 0x01, 0x08, 0x03, 0x06, 0x01, 0x07, 0x02, 0x06, 0x01, 0x09},
+	{0x04, 0x06, 0x01, 0x07, 0x02, 0x06, 0x01, 0x08, 0x03, 0x06, 0x01, 0x07, 0x02, 0x06, 0x01, 0x11},
+	{0x04, 0x06, 0x01, 0x07, 0x02, 0x06, 0x01, 0x08, 0x03, 0x06, 0x01, 0x07, 0x02, 0x06, 0x12, 0x16},
+	{0x04, 0x06, 0x01, 0x07, 0x02, 0x06, 0x01, 0x08, 0x03, 0x06, 0x01, 0x07, 0x13, 0x16, 0x11, 0x17},
+	{0x04, 0x06, 0x01, 0x07, 0x02, 0x06, 0x01, 0x08, 0x14, 0x16, 0x11, 0x17, 0x12, 0x16, 0x11, 0x18}
+};
+
+/*Same state machine for a single bit*/
+static const uint8_t stuffBit[STUFF_STATES][2] =
+{
+	{0x01, 0x06}, {0x02, 0x06}, {0x03, 0x06}, {0x04, 0x06}, {0x16, 0x06},
+	{0x01, 0x06}, {0x01, 0x07}, {0x01, 0x08}, {0x01, 0x09}, {0x01, 0x11}
+};
+
+/*Fields of a frame given to the stuffing and the CRC*/
+typedef struct
+{
+	uint32_t	count;		/*Bits before the stuffing*/
+	uint32_t	crc;		/*CRC of the bits*/
+	uint32_t	state;		/*State of the stuffing*/
+	uint32_t	stuff;		/*Stuff bits*/
+} Stream_t;
+
+static uint32_t loadBits[CAN_INSTANCE_COUNT][CAN_LOAD_BUCKETS];	/*Bits of each bucket*/
+static uint32_t loadBucket[CAN_INSTANCE_COUNT][CAN_LOAD_BUCKETS];	/*Bucket of the time held in each entry*/
+static CAN_BusLoad_t loadStats[CAN_INSTANCE_COUNT];				/*Load reported*/
+static uint64_t loadSum[CAN_INSTANCE_COUNT];						/*Loads sampled, for the average*/
+static uint32_t loadSamples[CAN_INSTANCE_COUNT];					/*Samples of the average*/
+
+/*Append the n lower bits of a value, MSB first, n from 1 to 32*/
+static void CAN_StreamPut(Stream_t *stream, uint32_t value, uint32_t n)
+{
+	uint32_t crc = stream->crc;
+	uint32_t state = stream->state;
+	uint32_t stuff = stream->stuff;
+	uint32_t next;
+	uint32_t bit;
+
+	stream->count += n;
+	value <<= 32 - n;
+
+	/*By nibbles, the rest bit by bit*/
+	for (; n >= 4; n -= 4, value <<= 4)
+	{
+		crc = ((crc << 4) & CRC_MASK) ^ crcNibble[((crc >> CRC_TOP_SHIFT) ^ (value >> 28)) & 0xF];
+		next = stuffNibble[state][value >> 28];
+		stuff += next >> 4;
+		state = next & 0xF;
+	}
+	for (; n; n--, value <<= 1)
+	{
+		bit = value >> 31;
+		next = stuffBit[state][bit];
+		stuff += next >> 4;
+		state = next & 0xF;
+
+		bit ^= crc >> (CRC_BITS - 1);
+		crc = (crc << 1) & CRC_MASK;
+		if (bit)
+			crc ^= CRC_POLY;
+	}
+
+	stream->crc = crc;
+	stream->state = state;
+	stream->stuff = stuff;
+}
+
+uint32_t CAN_FrameBits(const CAN_Frame_t* frame, uint8_t extended)
+{
+	Stream_t stream = {0, 0, STUFF_IDLE, 0};
+	uint32_t bytes = frame->Remote ? 0 : frame->Length;
+	uint32_t counter;
+
+	if (bytes > MAX_DATA_BYTES)
+		bytes = MAX_DATA_BYTES;
+
+	/*SOF and arbitration field*/
+	CAN_StreamPut(&stream, 0, 1);
+	if (extended)
+	{
+		CAN_StreamPut(&stream, (frame->ID >> SHIFT_EXT_ID) & CAN_EXACT_ID, 11);
+		CAN_StreamPut(&stream, 3, 2);									/*SRR and IDE recessive*/
+		CAN_StreamPut(&stream, frame->ID & ((1UL << SHIFT_EXT_ID) - 1), SHIFT_EXT_ID);
+		CAN_StreamPut(&stream, frame->Remote ? 4 : 0, 3);				/*RTR, r1 and r0*/
+	}
+	else
+	{
+		CAN_StreamPut(&stream, frame->ID & CAN_EXACT_ID, 11);
+		CAN_StreamPut(&stream, frame->Remote ? 4 : 0, 3);				/*RTR, IDE and r0*/
+	}
+	CAN_StreamPut(&stream, frame->Length & 0xF, 4);
+
+	/*Data bytes, byte 0 is the MSB of the first word*/
+	for (counter = 0; counter < bytes; counter++)
+		CAN_StreamPut(&stream, (frame->Data[counter >> 2] >> (24 - ((counter & 3) * 8))) & 0xFF, 8);
+
+	CAN_StreamPut(&stream, stream.crc, CRC_BITS);
+
+	return stream.count + stream.stuff + FRAME_TAIL_BITS;
+}
+
+/*Bus monitor of the port, adds the frame to the bucket of its time*/
+static void CAN_BusLoadAdd(PortCAN_t portCAN, const CAN_Frame_t* frame, uint32_t timeStamp)
+{
+	uint32_t bucket = timeStamp >> CAN_LOAD_BUCKET_SHIFT;
+	uint32_t entry = bucket & (CAN_LOAD_BUCKETS - 1);
+	uint32_t bits = CAN_FrameBits(frame, 0);	/*The driver only sends and receives standard IDs*/
+	uint32_t irqState;
+
+	irqState = CAN_EnterCritical();
+	if (loadBucket[portCAN][entry] != bucket)
+	{
+		loadBucket[portCAN][entry] = bucket;
+		loadBits[portCAN][entry] = 0;
+	}
+	loadBits[portCAN][entry] += bits;
+	loadStats[portCAN].frames++;
+	CAN_ExitCritical(irqState);
+}
+
+void CAN_BusLoadEnable(PortCAN_t portCAN)
+{
+	uint32_t entry;
+
+	/*No entry holds a bucket of the window yet*/
+	for (entry = 0; entry < CAN_LOAD_BUCKETS; entry++)
+	{
+		loadBucket[portCAN][entry] = 0xFFFFFFFF;
+		loadBits[portCAN][entry] = 0;
+	}
+	loadStats[portCAN].loadMin = LOAD_SCALE;
+	loadStats[portCAN].loadMax = 0;
+	loadSum[portCAN] = 0;
+	loadSamples[portCAN] = 0;
+
+	CAN_SetBusMonitor(portCAN, CAN_BusLoadAdd);
+}
+
+void CAN_BusLoadService(PortCAN_t portCAN)
+{
+	CAN_BusLoad_t *stats = &loadStats[portCAN];
+	uint32_t now = CAN_GetTime(portCAN) >> CAN_LOAD_BUCKET_SHIFT;
+	uint32_t irqState;
+	uint32_t bits = 0;
+	uint32_t entry;
+	uint32_t load;
+
+	/*The window is made of the buckets before the current one, which is still filling*/
+	irqState = CAN_EnterCritical();
+	for (entry = 0; entry < CAN_LOAD_BUCKETS; entry++)
+	{
+		if ((now - loadBucket[portCAN][entry] - 1) < (CAN_LOAD_BUCKETS - 1))
+			bits += loadBits[portCAN][entry];
+	}
+	CAN_ExitCritical(irqState);
+
+	/*A frame stamped at the end of a bucket spills over it, the load is capped*/
+	load = (uint32_t)(((uint64_t)bits * LOAD_SCALE) >> CAN_LOAD_BUCKET_SHIFT) / (CAN_LOAD_BUCKETS - 1);
+	if (load > LOAD_SCALE)
+		load = LOAD_SCALE;
+
+	stats->load = load;
+	if (load < stats->loadMin)
+		stats->loadMin = load;
+	if (load > stats->loadMax)
+		stats->loadMax = load;
+
+	loadSum[portCAN] += load;
+	loadSamples[portCAN]++;
+	stats->loadAvg = (uint32_t)(loadSum[portCAN] / loadSamples[portCAN]);
+}
+
+void CAN_BusLoadGet(PortCAN_t portCAN, CAN_BusLoad_t* load)
+{
+	*load = loadStats[portCAN];
+}
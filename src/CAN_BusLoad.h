@@ -0,0 +1,73 @@
+/**
+ *	\file	CAN_BusLoad.h
+ *	\brief
+ *			Exact length on the bus of a frame, with its CRC and stuff
+ *			bits, and load meter of each port. The meter adds the length
+ *			of every frame received or sent by the port in buckets of
+ *			time and reports the load of the last window.
+ */
+
+#ifndef CAN_BUSLOAD_H_
+#define CAN_BUSLOAD_H_
+
+#include "CAN.h"
+
+#define CAN_LOAD_BUCKETS		(16)	/*Buckets of the window, power of 2*/
+#define CAN_LOAD_BUCKET_SHIFT	(12)	/*4096 bit times per bucket*/
+
+/*Load of a port in hundredths of percent*/
+typedef struct
+{
+	uint32_t	load;		/*Load of the last window*/
+	uint32_t	loadMin;	/*Lowest load sampled*/
+	uint32_t	loadAvg;	/*Average of the loads sampled*/
+	uint32_t	loadMax;	/*Highest load sampled*/
+	uint32_t	frames;		/*Frames counted*/
+} CAN_BusLoad_t;
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Bits of a frame on the bus from the SOF to the interframe
+ 	 	 	 	space, with the stuff bits of its ID, data and CRC. The
+ 	 	 	 	bound over every payload is CAN_FrameBitsMax of CAN_Offset.h
+ 	 \param[in] Frame and 1 for an extended ID
+ 	 \return 	Bits on the bus
+ */
+uint32_t CAN_FrameBits(const CAN_Frame_t* frame, uint8_t extended);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Measure the load of a port, the meter takes the bus monitor
+ 	 	 	 	of the port. Only the frames accepted by the RX filters are
+ 	 	 	 	seen, the adaptive mode accepts the whole bus
+ 	 \param[in] CAN Port
+ 	 \return 	Void
+ */
+void CAN_BusLoadEnable(PortCAN_t portCAN);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Sample the load of the last window, it must be called
+ 	 	 	 	periodically, at least once per window
+ 	 \param[in] CAN Port
+ 	 \return 	Void
+ */
+void CAN_BusLoadService(PortCAN_t portCAN);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Load of a port
+ 	 \param[in] CAN Port and structure where the load is saved
+ 	 \return 	Void
+ */
+void CAN_BusLoadGet(PortCAN_t portCAN, CAN_BusLoad_t* load);
+
+#endif /* CAN_BUSLOAD_H_ */
@@ -0,0 +1,51 @@
+/**
+ *	\file	CAN_Coalesce.c
+ *	\brief
+ *			Interrupt coalescing of the RX FIFO with a LPIT timeout.
+ */
+
+#include "S32K144.h"
+#include "CAN.h"
+#include "CAN_Coalesce.h"
+#include "LPIT.h"
+
+static uint8_t coPorts;		/*Bit per coalesced port*/
+
+/*Timeout of the batch, the frames under the watermark are moved to the RX ring*/
+static void CAN_CoalesceTick(void)
+{
+	uint8_t port;
+
+	for (port = 0; port < CAN_INSTANCE_COUNT; port++)
+	{
+		if (coPorts & (1U << port))
+			(void)CAN_RxPoll((PortCAN_t)port);
+	}
+}
+
+uint8_t CAN_CoalesceAdd(PortCAN_t portCAN)
+{
+	if (!CAN_SetRxCoalescing(portCAN, 1))
+		return 0;
+
+	coPorts |= 1U << portCAN;
+
+	return 1;
+}
+
+void CAN_CoalesceStart(uint8_t channel, uint32_t maxLatencyUs)
+{
+	LPIT_Start(channel, maxLatencyUs, CAN_CoalesceTick);
+}
+
+void CAN_CoalesceGetStats(PortCAN_t portCAN, CAN_CoalesceStats_t* stats)
+{
+	CAN_RxIrqStats_t irq;
+
+	CAN_GetRxIrqStats(portCAN, &irq);
+
+	stats->frames = irq.frames;
+	stats->interrupts = irq.interrupts;
+	stats->polls = irq.polls;
+	stats->saved = (int32_t)(irq.frames - irq.interrupts - irq.polls);
+}
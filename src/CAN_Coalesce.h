@@ -0,0 +1,60 @@
+/**
+ *	\file	CAN_Coalesce.h
+ *	\brief
+ *			Interrupt coalescing of the RX FIFO. The FIFO of a port
+ *			interrupts only at the watermark of the hardware and a LPIT
+ *			channel drains the frames left under it, so a burst costs
+ *			one interrupt per watermark and no frame waits more than a
+ *			period of the timer.
+ */
+
+#ifndef CAN_COALESCE_H_
+#define CAN_COALESCE_H_
+
+#include "CAN.h"
+
+#define CAN_COALESCE_WATERMARK	(5)		/*Frames in the FIFO that raise the interrupt*/
+
+/*Work of a coalesced port*/
+typedef struct
+{
+	uint32_t	frames;			/*Frames taken from the FIFO*/
+	uint32_t	interrupts;		/*FIFO interrupts at the watermark*/
+	uint32_t	polls;			/*Timer ticks, with frames or not*/
+	int32_t		saved;			/*Interrupts saved against one per frame, negative when idle*/
+} CAN_CoalesceStats_t;
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Coalesce the RX interrupts of a port, CAN_EnableAdaptiveRx
+ 	 	 	 	must be called before. The promoted IDs keep one
+ 	 	 	 	interrupt per frame
+ 	 \param[in] CAN Port
+ 	 \return 	1 when coalesced, 0 when the port has no RX FIFO
+ */
+uint8_t CAN_CoalesceAdd(PortCAN_t portCAN);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Start the timer that drains the coalesced ports, LPIT_init
+ 	 	 	 	must be called before
+ 	 \param[in] LPIT channel and longest delay added to a frame in microseconds
+ 	 \return 	Void
+ */
+void CAN_CoalesceStart(uint8_t channel, uint32_t maxLatencyUs);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Work of a coalesced port since the start
+ 	 \param[in] CAN Port and structure where the metrics are saved
+ 	 \return 	Void
+ */
+void CAN_CoalesceGetStats(PortCAN_t portCAN, CAN_CoalesceStats_t* stats);
+
+#endif /* CAN_COALESCE_H_ */
@@ -0,0 +1,67 @@
+/**
+ *	\file	CAN_Critical.h
+ *	\brief
+ *			Critical sections of the driver and NVIC priorities of its
+ *			interrupts. CAN_EnterCritical raises BASEPRI to
+ *			CAN_IRQ_PRIORITY, so the time triggered interrupts keep
+ *			running. CAN_EnterCriticalAll sets PRIMASK and masks
+ *			everything.
+ */
+
+#ifndef CAN_CRITICAL_H_
+#define CAN_CRITICAL_H_
+
+#include "s32_core_cm4.h"
+#include "S32K144_features.h"
+
+#define CAN_TRIGGER_PRIORITY	(0)		/*Time triggered transmission, never masked*/
+#define CAN_IRQ_PRIORITY		(1)		/*Interrupts that call the driver*/
+
+/*Value of the NVIC priority registers and of BASEPRI for a level*/
+#define CAN_NVIC_PRIORITY(level)	((uint8_t)((level) << (8 - FEATURE_NVIC_PRIO_BITS)))
+
+/*Mask the interrupts of the driver and return the previous state. The
+  interrupts of CAN_TRIGGER_PRIORITY still run, they must not call the driver*/
+static inline uint32_t CAN_EnterCritical(void)
+{
+	uint32_t basepri;
+
+	__asm volatile ("mrs %0, basepri" : "=r" (basepri));
+	__asm volatile ("msr basepri_max, %0" : : "r" ((uint32_t)CAN_NVIC_PRIORITY(CAN_IRQ_PRIORITY)) : "memory");
+
+	return basepri;
+}
+
+/*Restore the interrupts saved by CAN_EnterCritical*/
+static inline void CAN_ExitCritical(uint32_t basepri)
+{
+	__asm volatile ("msr basepri, %0" : : "r" (basepri) : "memory");
+}
+
+/*Mask every interrupt, the time triggered ones included*/
+static inline uint32_t CAN_EnterCriticalAll(void)
+{
+	uint32_t primask;
+
+	__asm volatile ("mrs %0, primask" : "=r" (primask));
+	DISABLE_INTERRUPTS();
+
+	return primask;
+}
+
+/*Restore the interrupts saved by CAN_EnterCriticalAll*/
+static inline void CAN_ExitCriticalAll(uint32_t primask)
+{
+	__asm volatile ("msr primask, %0" : : "r" (primask) : "memory");
+}
+
+/*Enable an interrupt in the NVIC at a priority level*/
+#define CAN_EnableIRQLevel(irq, level)	do { \
+		S32_NVIC->IP[(uint32_t)(irq)] = CAN_NVIC_PRIORITY(level); \
+		S32_NVIC->ISER[(uint32_t)(irq) >> 5] = 1UL << ((uint32_t)(irq) & 0x1F); \
+	} while (0)
+
+/*Order the memory accesses shared with the interrupts*/
+#define CAN_MemoryBarrier()		__asm volatile ("dmb" : : : "memory")
+
+#endif /* CAN_CRITICAL_H_ */
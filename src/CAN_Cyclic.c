@@ -0,0 +1,157 @@
+/**
+ *	\file	CAN_Cyclic.c
+ *	\brief
+ *			Min-heap of the cyclic messages served by a LPIT tick.
+ */
+
+#include <stddef.h>
+#include "S32K144.h"
+#include "CAN.h"
+#include "CAN_Critical.h"
+#include "CAN_Cyclic.h"
+#include "LPIT.h"
+
+static CAN_Cyclic_t cyMsg[CAN_CYCLIC_MAX];					/*Cyclic messages*/
+static CAN_CyclicStats_t cyStats[CAN_CYCLIC_MAX];			/*Metrics per message*/
+static uint32_t cyDue[CAN_CYCLIC_MAX];						/*Tick of the next frame*/
+static uint32_t cyLastSent[CAN_CYCLIC_MAX];				/*Time the last frame was sent, 0 before the first*/
+static uint16_t cyHeap[CAN_CYCLIC_MAX];					/*Messages, the earliest due first*/
+static uint16_t cyCount;									/*Messages in the heap*/
+static volatile uint32_t cyNow;								/*Ticks since the start*/
+
+/*Tick a before tick b, valid while they are less than 2^31 ticks apart*/
+static uint8_t CAN_CyclicBefore(uint32_t a, uint32_t b)
+{
+	return ((int32_t)(a - b)) < 0;
+}
+
+/*Move up a message whose due tick decreased*/
+static void CAN_CyclicSiftUp(uint16_t pos)
+{
+	uint16_t msg = cyHeap[pos];
+	uint16_t parent;
+
+	while (pos > 0)
+	{
+		parent = (pos - 1) >> 1;
+		if (!CAN_CyclicBefore(cyDue[msg], cyDue[cyHeap[parent]]))
+			break;
+		cyHeap[pos] = cyHeap[parent];
+		pos = parent;
+	}
+	cyHeap[pos] = msg;
+}
+
+/*Move down a message whose due tick increased*/
+static void CAN_CyclicSiftDown(uint16_t pos)
+{
+	uint16_t msg = cyHeap[pos];
+	uint16_t child;
+
+	for (;;)
+	{
+		child = (pos << 1) + 1;
+		if (child >= cyCount)
+			break;
+		if (((child + 1) < cyCount) && CAN_CyclicBefore(cyDue[cyHeap[child + 1]], cyDue[cyHeap[child]]))
+			child++;
+		if (!CAN_CyclicBefore(cyDue[cyHeap[child]], cyDue[msg]))
+			break;
+		cyHeap[pos] = cyHeap[child];
+		pos = child;
+	}
+	cyHeap[pos] = msg;
+}
+
+/*Completion of a frame, the interval between two frames comes from the time stamp of the TX MB*/
+static void CAN_CyclicTxDone(PortCAN_t portCAN, void* context, CAN_TxStatus_t status, uint32_t sent)
+{
+	CAN_CyclicStats_t *stats;
+	uint16_t msg = (uint16_t)((const CAN_Cyclic_t*)context - cyMsg);
+	uint32_t interval;
+
+	/*The stamps are bit times of the port sending the message, a completion of another port is not counted*/
+	if ((TX_DONE != status) || (cyMsg[msg].port != portCAN))
+		return;
+
+	stats = &cyStats[msg];
+	stats->sent++;
+
+	if (stats->sent > 1)
+	{
+		interval = sent - cyLastSent[msg];
+		if ((interval < stats->intervalMin) || (2 == stats->sent))
+			stats->intervalMin = interval;
+		if (interval > stats->intervalMax)
+			stats->intervalMax = interval;
+		stats->jitter = stats->intervalMax - stats->intervalMin;
+	}
+	cyLastSent[msg] = sent;
+}
+
+/*Tick of the LPIT channel, sends every due message*/
+static void CAN_CyclicTick(void)
+{
+	uint16_t msg;
+	uint8_t handle;
+
+	cyNow++;
+
+	while (cyCount && !CAN_CyclicBefore(cyNow, cyDue[cyHeap[0]]))
+	{
+		msg = cyHeap[0];
+
+		/*The completion of each frame comes back with its message, the TX callback of the port is left to the application*/
+		handle = CAN_SendAsync(cyMsg[msg].port, &cyMsg[msg].frame, NULL, CAN_CyclicTxDone, &cyMsg[msg]);
+		if (handle >= CAN_TX_POOL_SIZE)
+			cyStats[msg].missed++;
+
+		/*The next frame keeps the phase, a late tick does not shift it*/
+		cyDue[msg] += cyMsg[msg].period;
+		CAN_CyclicSiftDown(0);
+	}
+}
+
+uint16_t CAN_CyclicAdd(const CAN_Cyclic_t* cyclic)
+{
+	uint32_t irqState;
+	uint16_t msg;
+
+	if ((CAN_CYCLIC_MAX == cyCount) || (0 == cyclic->period))
+		return CAN_CYCLIC_FULL;
+
+	irqState = CAN_EnterCritical();
+	msg = cyCount;
+	cyMsg[msg] = *cyclic;
+	cyDue[msg] = cyNow + cyclic->offset + 1;
+	cyHeap[cyCount] = msg;
+	cyCount++;
+	CAN_CyclicSiftUp(cyCount - 1);
+	CAN_ExitCritical(irqState);
+
+	return msg;
+}
+
+void CAN_CyclicUpdate(uint16_t index, uint32_t dataWord1, uint32_t dataWord2)
+{
+	uint32_t irqState;
+
+	irqState = CAN_EnterCritical();
+	cyMsg[index].frame.Data[0] = dataWord1;
+	cyMsg[index].frame.Data[1] = dataWord2;
+	CAN_ExitCritical(irqState);
+}
+
+void CAN_CyclicStart(uint8_t channel, uint32_t tickUs)
+{
+	LPIT_Start(channel, tickUs, CAN_CyclicTick);
+}
+
+void CAN_CyclicGetStats(uint16_t index, CAN_CyclicStats_t* stats)
+{
+	uint32_t irqState;
+
+	irqState = CAN_EnterCritical();
+	*stats = cyStats[index];
+	CAN_ExitCritical(irqState);
+}
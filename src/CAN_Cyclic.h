@@ -0,0 +1,80 @@
+/**
+ *	\file	CAN_Cyclic.h
+ *	\brief
+ *			Cyclic transmission driven by a LPIT channel. The timer
+ *			interrupt takes the due messages from a min-heap ordered by
+ *			their next tick and writes them in the TX pool, so a tick
+ *			costs O(log n) per due message. The TX jitter of each message
+ *			is measured from the time stamps of the frames sent.
+ */
+
+#ifndef CAN_CYCLIC_H_
+#define CAN_CYCLIC_H_
+
+#include "CAN.h"
+
+#define CAN_CYCLIC_MAX		(256)		/*Cyclic messages*/
+#define CAN_CYCLIC_FULL		(0xFFFF)	/*Index returned when the table is full*/
+
+/*Cyclic message*/
+typedef struct
+{
+	PortCAN_t	port;		/*Port sending the frame*/
+	CAN_Frame_t	frame;		/*Frame sent*/
+	uint32_t	period;		/*Ticks between two frames, not 0*/
+	uint32_t	offset;		/*Ticks to the first frame*/
+} CAN_Cyclic_t;
+
+/*Metrics of a cyclic message, the intervals are in bit times of the port*/
+typedef struct
+{
+	uint32_t	sent;			/*Frames sent*/
+	uint32_t	missed;			/*Ticks that found the TX pool full*/
+	uint32_t	intervalMin;	/*Shortest time between two frames sent*/
+	uint32_t	intervalMax;	/*Longest time between two frames sent*/
+	uint32_t	jitter;			/*intervalMax - intervalMin*/
+} CAN_CyclicStats_t;
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Add a cyclic message, its frames are sent with CAN_SendAsync
+ 	 	 	 	to measure the jitter, the TX callback of the port is not used
+ 	 \param[in] Cyclic message
+ 	 \return 	Index of the message or CAN_CYCLIC_FULL
+ */
+uint16_t CAN_CyclicAdd(const CAN_Cyclic_t* cyclic);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Change the data of a cyclic message, the next frame sends it
+ 	 \param[in] Index of the message and data words
+ 	 \return 	Void
+ */
+void CAN_CyclicUpdate(uint16_t index, uint32_t dataWord1, uint32_t dataWord2);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Start the ticks of the scheduler in a LPIT channel, LPIT_init
+ 	 	 	 	must be called before
+ 	 \param[in] LPIT channel and tick in microseconds
+ 	 \return 	Void
+ */
+void CAN_CyclicStart(uint8_t channel, uint32_t tickUs);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Metrics of a cyclic message
+ 	 \param[in] Index of the message and structure where the metrics are saved
+ 	 \return 	Void
+ */
+void CAN_CyclicGetStats(uint16_t index, CAN_CyclicStats_t* stats);
+
+#endif /* CAN_CYCLIC_H_ */
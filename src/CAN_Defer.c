@@ -0,0 +1,77 @@
+/**
+ *	\file	CAN_Defer.c
+ *	\brief
+ *			PendSV bottom halves of the CAN interrupts.
+ */
+
+#include <stddef.h>
+#include "S32K144.h"
+#include "CAN.h"
+#include "CAN_Critical.h"
+#include "CAN_Defer.h"
+
+#define DWT_CTRL			(*(volatile uint32_t*)0xE0001000UL)	/*Control of the DWT*/
+#define DWT_CTRL_CYCCNTENA	(0x00000001)						/*Cycle counter enabled*/
+#define DEMCR				(*(volatile uint32_t*)0xE000EDFCUL)	/*Debug exception and monitor control*/
+#define DEMCR_TRCENA		(0x01000000)						/*DWT and ITM enabled*/
+
+static CAN_DeferFn_t deferFn[CAN_DEFER_MAX];	/*Registered bottom halves*/
+static uint8_t deferCount;						/*Functions registered*/
+static uint32_t deferPending;					/*Bit per function and port posted*/
+
+void CAN_DeferInit(void)
+{
+	S32_SCB->SHPR3 = (S32_SCB->SHPR3 & ~S32_SCB_SHPR3_PRI_14_MASK) |
+			S32_SCB_SHPR3_PRI_14(CAN_NVIC_PRIORITY(CAN_DEFER_PRIORITY));
+
+	DEMCR |= DEMCR_TRCENA;
+	CAN_CycleCount() = 0;
+	DWT_CTRL |= DWT_CTRL_CYCCNTENA;
+}
+
+uint8_t CAN_DeferRegister(CAN_DeferFn_t function)
+{
+	uint32_t irqState;
+	uint8_t id = CAN_DEFER_FULL;
+
+	irqState = CAN_EnterCritical();
+	if (deferCount < CAN_DEFER_MAX)
+	{
+		id = deferCount;
+		deferFn[id] = function;
+		deferCount++;
+	}
+	CAN_ExitCritical(irqState);
+
+	return id;
+}
+
+void CAN_DeferPost(uint8_t id, PortCAN_t portCAN)
+{
+	uint32_t irqState;
+
+	irqState = CAN_EnterCritical();
+	deferPending |= 1UL << ((id * CAN_INSTANCE_COUNT) + portCAN);
+	CAN_ExitCritical(irqState);
+
+	S32_SCB->ICSR = S32_SCB_ICSR_PENDSVSET_MASK;
+}
+
+/*Run the posted bottom halves, a post during the run pends PendSV again*/
+void PendSV_Handler(void)
+{
+	uint32_t irqState;
+	uint32_t pending;
+	uint8_t bit;
+
+	irqState = CAN_EnterCritical();
+	pending = deferPending;
+	deferPending = 0;
+	CAN_ExitCritical(irqState);
+
+	for (bit = 0; pending; bit++, pending >>= 1)
+	{
+		if (pending & 1)
+			deferFn[bit / CAN_INSTANCE_COUNT]((PortCAN_t)(bit % CAN_INSTANCE_COUNT));
+	}
+}
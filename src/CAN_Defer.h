@@ -0,0 +1,58 @@
+/**
+ *	\file	CAN_Defer.h
+ *	\brief
+ *			Bottom halves of the CAN interrupts. An interrupt posts a
+ *			registered function for a port and pends PendSV, the
+ *			function runs from PendSV at the lowest priority once per
+ *			post or less: posts of the same function and port before it
+ *			runs are merged, the function drains its own queue.
+ */
+
+#ifndef CAN_DEFER_H_
+#define CAN_DEFER_H_
+
+#include "CAN.h"
+
+#define CAN_DEFER_MAX		(8)			/*Functions registered*/
+#define CAN_DEFER_FULL		(0xFF)		/*Id returned when the table is full*/
+#define CAN_DEFER_PRIORITY	(15)		/*PendSV, under every interrupt*/
+
+/*Bottom half of a port*/
+typedef void (*CAN_DeferFn_t)(PortCAN_t portCAN);
+
+/*Cycles of the core, DWT->CYCCNT enabled by CAN_DeferInit*/
+#define CAN_CycleCount()	(*(volatile uint32_t*)0xE0001004UL)
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Set PendSV to the lowest priority and start the cycle counter
+ 	 	 	 	of the DWT
+ 	 \param[in] Void
+ 	 \return 	Void
+ */
+void CAN_DeferInit(void);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Register a bottom half
+ 	 \param[in] Function run from PendSV
+ 	 \return 	Id of the function or CAN_DEFER_FULL
+ */
+uint8_t CAN_DeferRegister(CAN_DeferFn_t function);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Run a bottom half for a port from PendSV, it can be called
+ 	 	 	 	from any interrupt under CAN_TRIGGER_PRIORITY
+ 	 \param[in] Id of the function and CAN Port
+ 	 \return 	Void
+ */
+void CAN_DeferPost(uint8_t id, PortCAN_t portCAN);
+
+#endif /* CAN_DEFER_H_ */
@@ -0,0 +1,110 @@
+/**
+ *	\file	CAN_Gateway.c
+ *	\brief
+ *			Routing table of the gateway and hook of the RX interrupt
+ *			forwarding the frames to the destination TX pools.
+ */
+
+#include <stddef.h>
+#include "S32K144.h"
+#include "CAN.h"
+#include "CAN_Gateway.h"
+
+#define TIMER_MASK			(0x0000FFFF)	/*Bits of the stamp of the frames*/
+
+static CAN_Route_t gwRoute[CAN_GW_ROUTES];			/*Routing table*/
+static CAN_RouteStats_t gwStats[CAN_GW_ROUTES];	/*Metrics per route*/
+static volatile uint8_t gwRouteCount;				/*Routes written, read by the interrupts*/
+
+/*Hook of the source ports, the frames of a route do not go to the RX ring*/
+static uint8_t CAN_GatewayHook(PortCAN_t portCAN, const Rx_t* frame)
+{
+	const CAN_Route_t *route;
+	CAN_TxOptions_t options;
+	CAN_Frame_t out;
+	uint32_t latency;
+	uint8_t result;
+	uint8_t index;
+	uint8_t port;
+
+	/*The frames sent by the port are not routed back*/
+	if (frame->RxOwn)
+		return 0;
+
+	for (index = 0; index < gwRouteCount; index++)
+	{
+		route = &gwRoute[index];
+
+		if ((route->source == portCAN) && !((frame->RxID ^ route->ID) & route->mask))
+			break;
+	}
+
+	if (index == gwRouteCount)
+		return 0;
+
+	/*DLC and payload pass through*/
+	out.ID = (CAN_GW_SAME_ID == route->newID) ? frame->RxID :
+			((route->newID & route->mask) | (frame->RxID & ~route->mask & CAN_EXACT_ID));
+	out.Length = frame->RxLength;
+	out.Data[0] = frame->RxData[0];
+	out.Data[1] = frame->RxData[1];
+	out.Remote = (uint8_t)frame->RxRemote;
+
+	options.timeout = route->timeout;
+	options.mode = TX_RETRY;
+	options.tag = index;
+
+	for (port = 0; port < CAN_INSTANCE_COUNT; port++)
+	{
+		if (route->destinations & CAN_GW_TO(port))
+		{
+			result = CAN_Send((PortCAN_t)port, &out, &options);
+			if (result < CAN_TX_POOL_SIZE)
+				gwStats[index].forwarded++;
+			else if (CAN_TX_DEFERRED == result)
+				gwStats[index].deferred++;
+			else
+				gwStats[index].dropped++;
+		}
+	}
+
+	/*The stamp is the 16 bits timer of the source*/
+	latency = (CAN_GetTime(portCAN) - frame->RxTimeStamp) & TIMER_MASK;
+	gwStats[index].latency = latency;
+	if (latency > gwStats[index].latencyMax)
+		gwStats[index].latencyMax = latency;
+
+	return 1;
+}
+
+uint8_t CAN_GatewayAddRoute(const CAN_Route_t* route)
+{
+	CAN_RxFilter_t filter;
+	uint8_t index = gwRouteCount;
+
+	if (CAN_GW_ROUTES == index)
+		return CAN_GW_NO_ROUTE;
+
+	/*The route is visible to the hook once it is complete*/
+	gwRoute[index] = *route;
+	gwRouteCount = index + 1;
+
+	filter.ID = route->ID;
+	filter.mask = route->mask;
+	filter.delivery = RX_QUEUED;
+	if (CAN_NO_MB == CAN_AddRxFilter(route->source, &filter))
+	{
+		gwRouteCount = index;
+		return CAN_GW_NO_ROUTE;
+	}
+
+	/*A port without route keeps its own hook*/
+	CAN_SetRxHook(route->source, CAN_GatewayHook);
+
+	return index;
+}
+
+void CAN_GatewayGetStats(uint8_t route, CAN_RouteStats_t* stats)
+{
+	*stats = gwStats[route];
+}
@@ -0,0 +1,65 @@
+/**
+ *	\file	CAN_Gateway.h
+ *	\brief
+ *			Routing of frames between the CAN ports. The RX interrupt of
+ *			the source port writes each routed frame straight into the
+ *			TX pool of the destination ports, the frames without route
+ *			go to the RX ring.
+ */
+
+#ifndef CAN_GATEWAY_H_
+#define CAN_GATEWAY_H_
+
+#include "CAN.h"
+
+#define CAN_GW_ROUTES		(16)			/*Routes of the table*/
+#define CAN_GW_NO_ROUTE		(0xFF)			/*Route returned when the route is not added*/
+#define CAN_GW_SAME_ID		(0xFFFFFFFF)	/*Route forwarding the received ID*/
+
+/*Destination port of a route*/
+#define CAN_GW_TO(port)		(1U << (port))
+
+/*Route of the table*/
+typedef struct
+{
+	PortCAN_t	source;			/*Port receiving the frames*/
+	uint32_t	ID;				/*Standard identifier accepted*/
+	uint32_t	mask;			/*Bits of the ID compared, CAN_EXACT_ID for one ID*/
+	uint8_t		destinations;	/*CAN_GW_TO() of each destination port*/
+	uint32_t	newID;			/*Bits under the mask replaced, CAN_GW_SAME_ID keeps the ID*/
+	uint32_t	timeout;		/*Deadline in the TX pool in bit times, 0 waits forever*/
+} CAN_Route_t;
+
+/*Metrics of a route*/
+typedef struct
+{
+	uint32_t	forwarded;		/*Frames written in a destination TX pool*/
+	uint32_t	deferred;		/*Frames held by the admission check of a destination, sent later*/
+	uint32_t	dropped;		/*Frames not taken by a destination TX pool*/
+	uint32_t	latency;		/*Bit times of the source from the reception to the TX pool, last frame*/
+	uint32_t	latencyMax;		/*Worst latency*/
+} CAN_RouteStats_t;
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Add a route, the ID is accepted in a message buffer of the
+ 	 	 	 	source port and the hook of the gateway is set on it. The
+ 	 	 	 	first route matching a frame forwards it
+ 	 \param[in] Route
+ 	 \return 	Index of the route or CAN_GW_NO_ROUTE
+ */
+uint8_t CAN_GatewayAddRoute(const CAN_Route_t* route);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Metrics of a route
+ 	 \param[in] Index of the route and structure where the metrics are saved
+ 	 \return 	Void
+ */
+void CAN_GatewayGetStats(uint8_t route, CAN_RouteStats_t* stats);
+
+#endif /* CAN_GATEWAY_H_ */
@@ -0,0 +1,221 @@
+/**
+ *	\file	CAN_Offset.c
+ *	\brief
+ *			Greedy planner of the offsets of the cyclic messages. It has
+ *			no access to the hardware so it is also built on the host:
+ *
+ *			gcc -DCAN_OFFSET_MAIN -Isrc src/CAN_Offset.c -o can_offset
+ *			./can_offset PORT < messages.txt > table.c
+ *
+ *			with one "ID DLC PERIOD" line per message (hexadecimal ID,
+ *			period in ticks). The output is the initializer of a
+ *			CAN_Cyclic_t table with the offsets planned.
+ */
+
+#include <stdint.h>
+#include "CAN_Offset.h"
+
+#define FRAME_FIXED_BITS	(47)			/*Standard data frame without data, interframe space included*/
+#define FRAME_STUFFED_BITS	(34)			/*Bits from SOF to CRC without data, the ones stuffed*/
+#define MAX_DLC				(8)				/*Data bytes of a classic frame*/
+#define OFFSET_UNSET		(0xFFFFFFFF)	/*Message not placed yet*/
+
+uint32_t CAN_FrameBitsMax(uint32_t length)
+{
+	if (length > MAX_DLC)
+		length = MAX_DLC;
+
+	/*One stuff bit every 4 bits after the first 5 of the stuffed fields*/
+	return FRAME_FIXED_BITS + (8 * length) + ((FRAME_STUFFED_BITS + (8 * length) - 1) / 4);
+}
+
+/*Greatest common divisor of two periods*/
+static uint32_t CAN_OffsetGcd(uint32_t a, uint32_t b)
+{
+	uint32_t rest;
+
+	while (b)
+	{
+		rest = a % b;
+		a = b;
+		b = rest;
+	}
+
+	return a;
+}
+
+/*Next message to place, the shortest period and then the longest frame*/
+static int32_t CAN_OffsetNext(PortCAN_t portCAN, const CAN_Cyclic_t* table, uint16_t count)
+{
+	int32_t next = -1;
+	uint16_t msg;
+
+	for (msg = 0; msg < count; msg++)
+	{
+		/*A message without period is not planned, as in the hyperperiod*/
+		if ((table[msg].port != portCAN) || (0 == table[msg].period) || (OFFSET_UNSET != table[msg].offset))
+			continue;
+
+		if ((next < 0) ||
+			(table[msg].period < table[next].period) ||
+			((table[msg].period == table[next].period) &&
+			 (table[msg].frame.Length > table[next].frame.Length)))
+			next = msg;
+	}
+
+	return next;
+}
+
+/*Busiest tick of the load buffer*/
+static uint32_t CAN_OffsetPeak(const uint32_t* load, uint32_t hyperperiod)
+{
+	uint32_t peak = 0;
+	uint32_t tick;
+
+	for (tick = 0; tick < hyperperiod; tick++)
+	{
+		if (load[tick] > peak)
+			peak = load[tick];
+	}
+
+	return peak;
+}
+
+/*Add the frames of a message to the load of every tick it is sent*/
+static void CAN_OffsetAdd(uint32_t* load, uint32_t hyperperiod, const CAN_Cyclic_t* msg, uint32_t offset)
+{
+	uint32_t bits = CAN_FrameBitsMax(msg->frame.Length);
+	uint32_t tick;
+
+	for (tick = offset; tick < hyperperiod; tick += msg->period)
+		load[tick] += bits;
+}
+
+uint8_t CAN_OffsetPlan(PortCAN_t portCAN, CAN_Cyclic_t* table, uint16_t count,
+		uint32_t* load, uint32_t slots, CAN_OffsetResult_t* result)
+{
+	uint32_t hyperperiod = 1;
+	uint32_t offset;
+	uint32_t best;
+	uint32_t bestPeak;
+	uint32_t bestSum;
+	uint32_t peak;
+	uint32_t sum;
+	uint32_t tick;
+	uint16_t msg;
+	int32_t next;
+
+	/*The load repeats every hyperperiod*/
+	for (msg = 0; msg < count; msg++)
+	{
+		if ((table[msg].port != portCAN) || (0 == table[msg].period))
+			continue;
+
+		hyperperiod = (hyperperiod / CAN_OffsetGcd(hyperperiod, table[msg].period)) * table[msg].period;
+		if (hyperperiod > slots)
+			return 0;
+	}
+
+	/*Load with every offset 0, the reference of the plan*/
+	for (tick = 0; tick < hyperperiod; tick++)
+		load[tick] = 0;
+	for (msg = 0; msg < count; msg++)
+	{
+		if ((table[msg].port == portCAN) && table[msg].period)
+		{
+			CAN_OffsetAdd(load, hyperperiod, &table[msg], 0);
+			table[msg].offset = OFFSET_UNSET;
+		}
+	}
+	result->hyperperiod = hyperperiod;
+	result->peakBitsZero = CAN_OffsetPeak(load, hyperperiod);
+
+	for (tick = 0; tick < hyperperiod; tick++)
+		load[tick] = 0;
+
+	while ((next = CAN_OffsetNext(portCAN, table, count)) >= 0)
+	{
+		best = 0;
+		bestPeak = OFFSET_UNSET;
+		bestSum = OFFSET_UNSET;
+
+		/*The lowest busiest tick, then the least bits shared, then the earliest offset*/
+		for (offset = 0; offset < table[next].period; offset++)
+		{
+			peak = 0;
+			sum = 0;
+			for (tick = offset; tick < hyperperiod; tick += table[next].period)
+			{
+				if (load[tick] > peak)
+					peak = load[tick];
+				sum += load[tick];
+			}
+
+			if ((peak < bestPeak) || ((peak == bestPeak) && (sum < bestSum)))
+			{
+				best = offset;
+				bestPeak = peak;
+				bestSum = sum;
+			}
+		}
+
+		table[next].offset = best;
+		CAN_OffsetAdd(load, hyperperiod, &table[next], best);
+	}
+
+	result->peakBits = CAN_OffsetPeak(load, hyperperiod);
+
+	return 1;
+}
+
+#ifdef CAN_OFFSET_MAIN
+#include <stdio.h>
+#include <stdlib.h>
+
+#define HOST_MESSAGES		(CAN_CYCLIC_MAX)	/*Messages read*/
+#define HOST_SLOTS			(100000)			/*Longest hyperperiod in ticks*/
+
+static CAN_Cyclic_t hostTable[HOST_MESSAGES];
+static uint32_t hostLoad[HOST_SLOTS];
+
+int main(int argc, char *argv[])
+{
+	CAN_OffsetResult_t result;
+	PortCAN_t port = (argc > 1) ? (PortCAN_t)atoi(argv[1]) : CAN_0;
+	unsigned int ID;
+	unsigned int length;
+	unsigned int period;
+	uint16_t count = 0;
+	uint16_t msg;
+
+	while ((count < HOST_MESSAGES) && (3 == scanf("%x %u %u", &ID, &length, &period)))
+	{
+		hostTable[count].port = port;
+		hostTable[count].frame.ID = ID;
+		hostTable[count].frame.Length = length;
+		hostTable[count].period = period;
+		count++;
+	}
+
+	if (!CAN_OffsetPlan(port, hostTable, count, hostLoad, HOST_SLOTS, &result))
+	{
+		fprintf(stderr, "hyperperiod longer than %u ticks\n", HOST_SLOTS);
+		return 1;
+	}
+
+	printf("/*Hyperperiod %lu ticks, busiest tick %lu bits (%lu bits with every offset 0)*/\n",
+			(unsigned long)result.hyperperiod, (unsigned long)result.peakBits,
+			(unsigned long)result.peakBitsZero);
+	printf("const CAN_Cyclic_t CAN_CyclicTable[%u] =\n{\n", count);
+	for (msg = 0; msg < count; msg++)
+	{
+		printf("\t{CAN_%u, {0x%03lX, %lu, {0, 0}, 0}, %lu, %lu}%s\n", (unsigned int)port,
+				(unsigned long)hostTable[msg].frame.ID, (unsigned long)hostTable[msg].frame.Length,
+				(unsigned long)hostTable[msg].period, (unsigned long)hostTable[msg].offset,
+				((msg + 1) < count) ? "," : "");
+	}
+	printf("};\n");
+
+	return 0;
+}
+#endif
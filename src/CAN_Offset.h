@@ -0,0 +1,61 @@
+/**
+ *	\file	CAN_Offset.h
+ *	\brief
+ *			Planner of the offsets of the cyclic messages of a port.
+ *			The messages with the same multiple of the period are spread
+ *			in different ticks so the peak of bits queued in one tick,
+ *			and with it the worst queuing delay, is as low as possible.
+ *			The planner is plain C, it runs at boot on the target or on
+ *			the host to generate the table of the cyclic scheduler.
+ */
+
+#ifndef CAN_OFFSET_H_
+#define CAN_OFFSET_H_
+
+#include "CAN_Cyclic.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*Result of a plan, the loads are worst case bits of the frames in one tick*/
+typedef struct
+{
+	uint32_t	hyperperiod;	/*Ticks evaluated, least common multiple of the periods*/
+	uint32_t	peakBits;		/*Busiest tick with the offsets planned*/
+	uint32_t	peakBitsZero;	/*Busiest tick with every offset 0*/
+} CAN_OffsetResult_t;
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Bits of a standard data frame with the worst bit stuffing,
+ 	 	 	 	including the interframe space, the bound of CAN_FrameBits
+ 	 	 	 	of CAN_BusLoad.h. It is the only worst case length, the host
+ 	 	 	 	tools link it too
+ 	 \param[in] Data bytes
+ 	 \return 	Bits on the bus
+ */
+uint32_t CAN_FrameBitsMax(uint32_t length);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Write the offset of the messages of a port in the table. The
+ 	 	 	 	shortest periods and the longest frames are placed first,
+ 	 	 	 	each one in the offset whose busiest tick is the lowest
+ 	 \param[in] CAN Port, table of the cyclic scheduler, messages of the
+ 	 	 	 	table, buffer of the load of each tick, its length and
+ 	 	 	 	result
+ 	 \return 	1 when planned, 0 when the hyperperiod is longer than the buffer
+ */
+uint8_t CAN_OffsetPlan(PortCAN_t portCAN, CAN_Cyclic_t* table, uint16_t count,
+		uint32_t* load, uint32_t slots, CAN_OffsetResult_t* result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CAN_OFFSET_H_ */
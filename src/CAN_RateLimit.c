@@ -0,0 +1,280 @@
+/**
+ *	\file	CAN_RateLimit.c
+ *	\brief
+ *			Token buckets checked by CAN_Send, one hashed slot per ID so
+ *			the check of a frame is O(1).
+ */
+
+#include <stddef.h>
+#include "S32K144.h"
+#include "CAN.h"
+#include "CAN_Critical.h"
+#include "CAN_RateLimit.h"
+
+#define SHIFT_HASH			(5)				/*Mix of the high bits of the ID in the slot*/
+
+/*Bucket of a port or an ID*/
+typedef struct
+{
+	uint32_t		ID;			/*Limited ID, CAN_RL_PORT for the port*/
+	uint32_t		tokens;		/*Frames that can be sent now*/
+	uint32_t		last;		/*Time of the last token added*/
+	uint32_t		queued;		/*Frames deferred by this bucket and not sent yet*/
+	CAN_RateLimit_t	limit;		/*period 0 when the bucket is not used*/
+	CAN_RlStats_t	stats;		/*Counters*/
+} Bucket_t;
+
+/*Frame waiting for tokens*/
+typedef struct
+{
+	CAN_Frame_t		frame;
+	CAN_TxOptions_t	options;
+	Bucket_t		*bucket;	/*Bucket that deferred the frame*/
+	CAN_TxDone_t	done;		/*Completion of CAN_SendAsync, NULL for CAN_Send*/
+	void			*context;	/*Context of CAN_SendAsync*/
+	uint8_t			hasOptions;	/*0 when CAN_Send had NULL options*/
+	uint8_t			sent;		/*1 once the service sent it, freed when the tail passes*/
+} Deferred_t;
+
+static Bucket_t rlPort[CAN_INSTANCE_COUNT];							/*Bucket of each port*/
+static Bucket_t rlID[CAN_INSTANCE_COUNT][CAN_RL_ID_SLOTS];			/*Buckets of the IDs*/
+static Deferred_t rlDefer[CAN_INSTANCE_COUNT][CAN_RL_DEFER_SIZE];	/*Deferred frames*/
+static uint32_t rlDeferHead[CAN_INSTANCE_COUNT];					/*Written by CAN_Send*/
+static uint32_t rlDeferTail[CAN_INSTANCE_COUNT];					/*Written by the service*/
+static const CAN_Frame_t *rlRelease[CAN_INSTANCE_COUNT];			/*Deferred frame sent by the service*/
+
+/*Slot of an ID, two IDs with the same slot cannot be limited together*/
+static Bucket_t* CAN_RlSlot(PortCAN_t portCAN, uint32_t ID)
+{
+	return &rlID[portCAN][(ID ^ (ID >> SHIFT_HASH)) & (CAN_RL_ID_SLOTS - 1)];
+}
+
+/*Add the tokens of the time elapsed since the last one*/
+static void CAN_RlRefill(Bucket_t *bucket, uint32_t now)
+{
+	uint32_t tokens = (now - bucket->last) / bucket->limit.period;
+
+	if (tokens >= (bucket->limit.burst - bucket->tokens))
+	{
+		/*A full bucket does not save the time elapsed*/
+		bucket->tokens = bucket->limit.burst;
+		bucket->last = now;
+	}
+	else if (tokens)
+	{
+		bucket->tokens += tokens;
+		bucket->last += tokens * bucket->limit.period;
+	}
+}
+
+/*Buckets of a frame with the tokens of now, NULL when there is no limit*/
+static void CAN_RlBuckets(PortCAN_t portCAN, uint32_t ID, uint32_t now, Bucket_t **id, Bucket_t **port)
+{
+	*id = CAN_RlSlot(portCAN, ID);
+	if (!(*id)->limit.period || ((*id)->ID != ID))
+		*id = NULL;
+	else
+		CAN_RlRefill(*id, now);
+
+	*port = &rlPort[portCAN];
+	if (!(*port)->limit.period)
+		*port = NULL;
+	else
+		CAN_RlRefill(*port, now);
+}
+
+/*Take a token of each bucket, the caller is in a critical section*/
+static void CAN_RlTake(Bucket_t *id, Bucket_t *port)
+{
+	if (NULL != id)
+	{
+		id->tokens--;
+		id->stats.passed++;
+	}
+	if (NULL != port)
+	{
+		port->tokens--;
+		port->stats.passed++;
+	}
+}
+
+/*Admission check of CAN_Send and CAN_SendAsync*/
+static uint8_t CAN_RlAdmit(PortCAN_t portCAN, const CAN_Frame_t* frame, const CAN_TxOptions_t* options,
+		CAN_TxDone_t done, void* context)
+{
+	Bucket_t *id;
+	Bucket_t *port;
+	Bucket_t *empty = NULL;
+	Deferred_t *deferred;
+	uint32_t now;
+	uint32_t irqState;
+	uint32_t head;
+	uint8_t answer = CAN_TX_DROPPED;
+
+	/*The service already took the tokens of the frame it sends*/
+	if (frame == rlRelease[portCAN])
+		return CAN_TX_ADMITTED;
+
+	now = CAN_GetTime(portCAN);
+
+	irqState = CAN_EnterCritical();
+	CAN_RlBuckets(portCAN, frame->ID, now, &id, &port);
+
+	/*Behind the deferred frames of its buckets the frame keeps the order of its ID*/
+	if ((NULL != id) && (!id->tokens || id->queued))
+		empty = id;
+	else if ((NULL != port) && (!port->tokens || port->queued))
+		empty = port;
+
+	if (NULL == empty)
+	{
+		CAN_RlTake(id, port);
+		answer = CAN_TX_ADMITTED;
+	}
+	else
+	{
+		head = rlDeferHead[portCAN];
+
+		if ((RL_DEFER == empty->limit.policy) && ((head - rlDeferTail[portCAN]) < CAN_RL_DEFER_SIZE))
+		{
+			deferred = &rlDefer[portCAN][head & (CAN_RL_DEFER_SIZE - 1)];
+			deferred->frame = *frame;
+			deferred->bucket = empty;
+			deferred->done = done;
+			deferred->context = context;
+			deferred->sent = 0;
+			deferred->hasOptions = (NULL != options);
+			if (NULL != options)
+				deferred->options = *options;
+			rlDeferHead[portCAN] = head + 1;
+
+			empty->queued++;
+			empty->stats.deferred++;
+			answer = CAN_TX_DEFERRED;
+		}
+		else
+		{
+			empty->stats.dropped++;
+		}
+	}
+	CAN_ExitCritical(irqState);
+
+	return answer;
+}
+
+/*1 when an older deferred frame of the ID is still waiting, the frames of an ID leave in order*/
+static uint8_t CAN_RlWaiting(PortCAN_t portCAN, uint32_t index, uint32_t ID)
+{
+	const Deferred_t *older;
+	uint32_t counter;
+
+	for (counter = rlDeferTail[portCAN]; counter != index; counter++)
+	{
+		older = &rlDefer[portCAN][counter & (CAN_RL_DEFER_SIZE - 1)];
+		if (!older->sent && (older->frame.ID == ID))
+			return 1;
+	}
+
+	return 0;
+}
+
+uint8_t CAN_RateLimitSet(PortCAN_t portCAN, uint32_t ID, const CAN_RateLimit_t* limit)
+{
+	Bucket_t *bucket;
+	uint32_t irqState;
+
+	bucket = (CAN_RL_PORT == ID) ? &rlPort[portCAN] : CAN_RlSlot(portCAN, ID);
+
+	if (bucket->limit.period && (bucket->ID != ID))
+		return 0;
+
+	irqState = CAN_EnterCritical();
+	bucket->ID = ID;
+	bucket->limit = *limit;
+	bucket->tokens = limit->burst;
+	bucket->last = CAN_GetTime(portCAN);
+	CAN_ExitCritical(irqState);
+
+	CAN_SetTxAdmit(portCAN, CAN_RlAdmit);
+
+	return 1;
+}
+
+void CAN_RateLimitService(PortCAN_t portCAN)
+{
+	Deferred_t *deferred;
+	Bucket_t *id;
+	Bucket_t *port;
+	uint32_t irqState;
+	uint32_t index;
+	uint32_t now;
+	uint8_t handle;
+
+	now = CAN_GetTime(portCAN);
+
+	/*A frame without tokens is skipped, the frames of other IDs behind it are still sent*/
+	for (index = rlDeferTail[portCAN]; index != rlDeferHead[portCAN]; index++)
+	{
+		deferred = &rlDefer[portCAN][index & (CAN_RL_DEFER_SIZE - 1)];
+		if (deferred->sent || CAN_RlWaiting(portCAN, index, deferred->frame.ID))
+			continue;
+
+		irqState = CAN_EnterCritical();
+		CAN_RlBuckets(portCAN, deferred->frame.ID, now, &id, &port);
+		if ((NULL != port) && !port->tokens)
+		{
+			/*Every frame of the port needs the token of the port*/
+			CAN_ExitCritical(irqState);
+			break;
+		}
+		if ((NULL != id) && !id->tokens)
+		{
+			CAN_ExitCritical(irqState);
+			continue;
+		}
+		CAN_RlTake(id, port);
+		CAN_ExitCritical(irqState);
+
+		/*A frame of CAN_SendAsync is sent again with its completion*/
+		rlRelease[portCAN] = &deferred->frame;
+		if ((NULL != deferred->done) || (NULL != deferred->context))
+			handle = CAN_SendAsync(portCAN, &deferred->frame, deferred->hasOptions ? &deferred->options : NULL,
+					deferred->done, deferred->context);
+		else
+			handle = CAN_Send(portCAN, &deferred->frame, deferred->hasOptions ? &deferred->options : NULL);
+		rlRelease[portCAN] = NULL;
+
+		if (CAN_TX_POOL_FULL == handle)
+		{
+			/*The frame keeps its place and gives the tokens back*/
+			irqState = CAN_EnterCritical();
+			if (NULL != id)
+			{
+				id->tokens++;
+				id->stats.passed--;
+			}
+			if (NULL != port)
+			{
+				port->tokens++;
+				port->stats.passed--;
+			}
+			CAN_ExitCritical(irqState);
+			break;
+		}
+
+		irqState = CAN_EnterCritical();
+		deferred->bucket->queued--;
+		deferred->sent = 1;
+		CAN_ExitCritical(irqState);
+	}
+
+	/*Free the entries sent up to the first one still waiting*/
+	while ((rlDeferTail[portCAN] != rlDeferHead[portCAN]) &&
+			rlDefer[portCAN][rlDeferTail[portCAN] & (CAN_RL_DEFER_SIZE - 1)].sent)
+		rlDeferTail[portCAN]++;
+}
+
+void CAN_RateLimitGetStats(PortCAN_t portCAN, uint32_t ID, CAN_RlStats_t* stats)
+{
+	*stats = (CAN_RL_PORT == ID) ? rlPort[portCAN].stats : CAN_RlSlot(portCAN, ID)->stats;
+}
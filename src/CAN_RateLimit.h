@@ -0,0 +1,73 @@
+/**
+ *	\file	CAN_RateLimit.h
+ *	\brief
+ *			Token buckets in front of the TX pool, one per port and one
+ *			per limited ID. A frame is sent when its buckets have a
+ *			token, otherwise it is dropped or deferred by the policy of
+ *			the empty bucket.
+ */
+
+#ifndef CAN_RATELIMIT_H_
+#define CAN_RATELIMIT_H_
+
+#include "CAN.h"
+
+#define CAN_RL_ID_SLOTS		(32)			/*Limited IDs per port, power of 2*/
+#define CAN_RL_DEFER_SIZE	(8)				/*Deferred frames per port, power of 2*/
+#define CAN_RL_PORT			(0xFFFFFFFF)	/*ID of the bucket of the whole port*/
+
+/*Frames over the limit*/
+typedef enum {RL_DROP, RL_DEFER} CAN_RlPolicy_t;
+
+/*Limit of a bucket*/
+typedef struct
+{
+	uint32_t		burst;		/*Frames sent back to back by a full bucket*/
+	uint32_t		period;		/*Bit times per frame of the sustained rate, 0 removes the limit*/
+	CAN_RlPolicy_t	policy;		/*Frames over the limit dropped or deferred*/
+} CAN_RateLimit_t;
+
+/*Counters of a bucket*/
+typedef struct
+{
+	uint32_t	passed;		/*Frames given to the TX pool*/
+	uint32_t	dropped;	/*Frames discarded by this bucket*/
+	uint32_t	deferred;	/*Frames deferred by this bucket*/
+} CAN_RlStats_t;
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Limit the frames of an ID or of the whole port, the bucket
+ 	 	 	 	starts full. The check is installed in CAN_Send of the port
+ 	 \param[in] CAN Port, ID or CAN_RL_PORT and limit
+ 	 \return 	1 when set, 0 when the slot of the ID has another ID
+ */
+uint8_t CAN_RateLimitSet(PortCAN_t portCAN, uint32_t ID, const CAN_RateLimit_t* limit);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Send the deferred frames that have tokens again, in the order
+ 	 	 	 	they were deferred. A frame without tokens does not hold the
+ 	 	 	 	frames of other IDs, it must be called periodically. The
+ 	 	 	 	timeout of a deferred frame starts when it is sent and a
+ 	 	 	 	frame of CAN_SendAsync keeps its completion
+ 	 \param[in] CAN Port
+ 	 \return 	Void
+ */
+void CAN_RateLimitService(PortCAN_t portCAN);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Counters of a bucket
+ 	 \param[in] CAN Port, ID or CAN_RL_PORT and structure where they are saved
+ 	 \return 	Void
+ */
+void CAN_RateLimitGetStats(PortCAN_t portCAN, uint32_t ID, CAN_RlStats_t* stats);
+
+#endif /* CAN_RATELIMIT_H_ */
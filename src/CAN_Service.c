@@ -0,0 +1,115 @@
+/**
+ *	\file	CAN_Service.c
+ *	\brief
+ *			Round robin servicing of the CAN ports with a quota of
+ *			frames per port and turn.
+ */
+
+#include <stddef.h>
+#include "S32K144.h"
+#include "CAN.h"
+#include "CAN_Critical.h"
+#include "CAN_Service.h"
+
+#define TIMER_MASK			(0x0000FFFF)	/*Bits of the stamp of the frames*/
+
+static uint8_t serviceQuota[CAN_INSTANCE_COUNT];				/*0 when the port is not serviced*/
+static CAN_RxHandler_t serviceHandler[CAN_INSTANCE_COUNT];		/*Consumer of the frames*/
+static CAN_ServiceStats_t serviceStats[CAN_INSTANCE_COUNT];	/*Metrics per port*/
+static uint8_t serviceFirst;									/*Port served first in the next turn*/
+static volatile uint8_t serviceBusy;							/*1 while a turn runs*/
+
+/*Take at most the quota of frames of a port*/
+static uint32_t CAN_ServicePort(PortCAN_t portCAN)
+{
+	CAN_ServiceStats_t *stats = &serviceStats[portCAN];
+	uint32_t backlog;
+	uint32_t latency;
+	uint32_t count;
+	Rx_t frame;
+
+	backlog = CAN_GetRxBacklog(portCAN);
+	if (backlog > stats->backlogMax)
+		stats->backlogMax = backlog;
+
+	CAN_TxService(portCAN);
+	(void)CAN_RxNapiPoll(portCAN);		/*Bottom half of a FIFO masked by a burst*/
+
+	for (count = 0; (count < serviceQuota[portCAN]) && CAN_Receive(portCAN, &frame); count++)
+	{
+		/*The stamp is the 16 bits timer, valid for a latency under 65536 bit times*/
+		latency = (CAN_GetTime(portCAN) - frame.RxTimeStamp) & TIMER_MASK;
+		stats->latency = latency;
+		if (latency > stats->latencyMax)
+			stats->latencyMax = latency;
+
+		if (NULL != serviceHandler[portCAN])
+			serviceHandler[portCAN](portCAN, &frame);
+	}
+
+	stats->frames += count;
+	stats->backlog = CAN_GetRxBacklog(portCAN);
+	if ((count == serviceQuota[portCAN]) && stats->backlog)
+		stats->quotaHits++;
+	stats->lost = CAN_GetRxLost(portCAN);
+
+	return count;
+}
+
+void CAN_ServiceAddPort(PortCAN_t portCAN, uint8_t quota, CAN_RxHandler_t handler)
+{
+	uint32_t irqState;
+
+	irqState = CAN_EnterCritical();
+	serviceHandler[portCAN] = handler;
+	serviceQuota[portCAN] = quota;
+	CAN_ExitCritical(irqState);
+}
+
+uint32_t CAN_ServicePoll(void)
+{
+	uint32_t irqState;
+	uint32_t frames = 0;
+	uint8_t turn;
+	uint8_t port;
+
+	/*The RX rings have one reader, a nested call does not enter*/
+	irqState = CAN_EnterCritical();
+	if (serviceBusy)
+	{
+		CAN_ExitCritical(irqState);
+		return 0;
+	}
+	serviceBusy = 1;
+	CAN_ExitCritical(irqState);
+
+	for (turn = 0; turn < CAN_INSTANCE_COUNT; turn++)
+	{
+		port = (serviceFirst + turn) % CAN_INSTANCE_COUNT;
+
+		if (serviceQuota[port])
+			frames += CAN_ServicePort((PortCAN_t)port);
+	}
+
+	/*The next turn starts by the following port*/
+	serviceFirst = (serviceFirst + 1) % CAN_INSTANCE_COUNT;
+
+	serviceBusy = 0;
+
+	return frames;
+}
+
+void CAN_ServiceGetStats(PortCAN_t portCAN, CAN_ServiceStats_t* stats)
+{
+	*stats = serviceStats[portCAN];
+}
+
+void CAN_ServiceResetStats(PortCAN_t portCAN)
+{
+	CAN_ServiceStats_t *stats = &serviceStats[portCAN];
+
+	stats->frames = 0;
+	stats->backlogMax = 0;
+	stats->latencyMax = 0;
+	stats->quotaHits = 0;
+}
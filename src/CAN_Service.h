@@ -0,0 +1,74 @@
+/**
+ *	\file	CAN_Service.h
+ *	\brief
+ *			Servicing of several CAN ports with a bounded work per
+ *			port. Every turn visits the ports in round robin, starting
+ *			by a different port each turn, and takes at most the quota
+ *			of each one from its RX ring so a loaded port does not
+ *			starve the others.
+ */
+
+#ifndef CAN_SERVICE_H_
+#define CAN_SERVICE_H_
+
+#include "CAN.h"
+
+/*Called with each frame taken from the RX ring of a port*/
+typedef void (*CAN_RxHandler_t)(PortCAN_t portCAN, const Rx_t* frame);
+
+/*Metrics of a serviced port*/
+typedef struct
+{
+	uint32_t	frames;			/*Frames given to the handler*/
+	uint32_t	backlog;		/*Frames left in the RX ring after the last turn*/
+	uint32_t	backlogMax;		/*Deepest RX ring found at the start of a turn*/
+	uint32_t	latency;		/*Bit times from the reception to the handler, last frame*/
+	uint32_t	latencyMax;		/*Worst latency*/
+	uint32_t	quotaHits;		/*Turns ended by the quota with frames left*/
+	uint32_t	lost;			/*Frames dropped by the full RX ring*/
+} CAN_ServiceStats_t;
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Service a port, its RX ring is read only by the service
+ 	 	 	 	from now on
+ 	 \param[in] CAN Port, frames per turn (0 removes the port) and handler
+ 	 \return 	Void
+ */
+void CAN_ServiceAddPort(PortCAN_t portCAN, uint8_t quota, CAN_RxHandler_t handler);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	One turn over the serviced ports, it can be called from the
+ 	 	 	 	main loop and from a timer interrupt, a call that finds
+ 	 	 	 	another turn running returns at once
+ 	 \param[in] Void
+ 	 \return 	Frames given to the handlers
+ */
+uint32_t CAN_ServicePoll(void);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Metrics of a serviced port
+ 	 \param[in] CAN Port and structure where the metrics are saved
+ 	 \return 	Void
+ */
+void CAN_ServiceGetStats(PortCAN_t portCAN, CAN_ServiceStats_t* stats);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Clear the maximums and counters of a serviced port
+ 	 \param[in] CAN Port
+ 	 \return 	Void
+ */
+void CAN_ServiceResetStats(PortCAN_t portCAN);
+
+#endif /* CAN_SERVICE_H_ */
@@ -0,0 +1,107 @@
+/**
+ *	\file	CAN_Trigger.c
+ *	\brief
+ *			Time triggered transmission from the FTM0 compare interrupts.
+ */
+
+#include <stddef.h>
+#include "S32K144.h"
+#include "CAN.h"
+#include "CAN_Critical.h"
+#include "CAN_Trigger.h"
+#include "FTM.h"
+
+/*Frame of a FTM0 channel*/
+typedef struct
+{
+	CAN_TxTrigger_t	tx;
+	uint32_t		lastStamp;	/*TX time stamp of the previous frame*/
+	uint8_t			stamped;	/*1 when lastStamp belongs to the previous period*/
+} CAN_Triggered_t;
+
+static CAN_Triggered_t ttFrame[FTM_CHANNELS];
+static CAN_TriggerStats_t ttStats[FTM_CHANNELS];
+
+/*Compare of a channel, highest priority: the launch goes first and nothing of the driver is called*/
+static void CAN_TriggerFire(uint8_t channel)
+{
+	CAN_Triggered_t *tt = &ttFrame[channel];
+	CAN_TriggerStats_t *stats = &ttStats[channel];
+	uint32_t cs = *tt->tx.cs;
+	uint32_t late;
+	uint32_t interval;
+
+	if (CAN_TX_CODE_IDLE != (cs & CAN_TX_CODE_MASK))
+	{
+		/*The previous frame is still waiting for the bus, the next interval is not a period*/
+		stats->missed++;
+		tt->stamped = 0;
+		return;
+	}
+
+	CAN_FireTx(&tt->tx);
+	late = FTM_GetLate(channel);
+
+	if (late < stats->lateMin)
+		stats->lateMin = late;
+	if (late > stats->lateMax)
+		stats->lateMax = late;
+
+	/*The CS word read before the launch holds the stamp of the previous frame*/
+	if (stats->fired > 0)
+	{
+		if (tt->stamped)
+		{
+			interval = ((cs & CAN_TX_STAMP_MASK) - tt->lastStamp) & CAN_TX_STAMP_MASK;
+			if (interval < stats->intervalMin)
+				stats->intervalMin = interval;
+			if (interval > stats->intervalMax)
+				stats->intervalMax = interval;
+			stats->jitter = stats->intervalMax - stats->intervalMin;
+		}
+		tt->lastStamp = cs & CAN_TX_STAMP_MASK;
+		tt->stamped = 1;
+	}
+	stats->fired++;
+}
+
+uint8_t CAN_TriggerStart(PortCAN_t portCAN, const CAN_Frame_t* frame, uint8_t channel, uint32_t periodUs)
+{
+	CAN_Triggered_t *tt = &ttFrame[channel];
+	CAN_TriggerStats_t *stats = &ttStats[channel];
+	uint8_t mb;
+
+	FTM_Stop(channel);
+
+	mb = CAN_ArmTx(portCAN, frame, &tt->tx);
+	if (CAN_NO_MB == mb)
+		return mb;
+
+	tt->stamped = 0;
+	stats->fired = 0;
+	stats->missed = 0;
+	stats->lateMin = 0xFFFFFFFF;
+	stats->lateMax = 0;
+	stats->intervalMin = 0xFFFFFFFF;
+	stats->intervalMax = 0;
+	stats->jitter = 0;
+
+	FTM_Start(channel, periodUs, CAN_TriggerFire);
+
+	return mb;
+}
+
+uint8_t CAN_TriggerUpdate(uint8_t channel, uint32_t dataWord1, uint32_t dataWord2)
+{
+	return CAN_UpdateArmedTx(&ttFrame[channel].tx, dataWord1, dataWord2);
+}
+
+void CAN_TriggerGetStats(uint8_t channel, CAN_TriggerStats_t* stats)
+{
+	uint32_t irqState;
+
+	/*The compare interrupt is not masked by CAN_EnterCritical*/
+	irqState = CAN_EnterCriticalAll();
+	*stats = ttStats[channel];
+	CAN_ExitCriticalAll(irqState);
+}
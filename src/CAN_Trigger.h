@@ -0,0 +1,63 @@
+/**
+ *	\file	CAN_Trigger.h
+ *	\brief
+ *			Time triggered transmission launched by the output compare
+ *			of a FTM0 channel. The frame is armed as inactive in its own
+ *			message buffer, the compare interrupt runs over every other
+ *			interrupt and only writes the code of the MB. The delay of
+ *			the launch is read from the FTM counter and the intervals
+ *			between frames from the TX time stamps of the MB.
+ */
+
+#ifndef CAN_TRIGGER_H_
+#define CAN_TRIGGER_H_
+
+#include "CAN.h"
+#include "FTM.h"
+
+/*Metrics of a triggered frame*/
+typedef struct
+{
+	uint32_t	fired;			/*Frames launched*/
+	uint32_t	missed;			/*Compares that found the previous frame pending*/
+	uint32_t	lateMin;		/*Shortest delay from the compare to the launch, ticks of 100 ns*/
+	uint32_t	lateMax;		/*Longest delay from the compare to the launch*/
+	uint32_t	intervalMin;	/*Shortest time between two frames sent, bit times*/
+	uint32_t	intervalMax;	/*Longest time between two frames sent*/
+	uint32_t	jitter;			/*intervalMax - intervalMin*/
+} CAN_TriggerStats_t;
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Arm a frame in a free message buffer and launch it from a
+ 	 	 	 	FTM0 channel on every period, FTM_init must be called
+ 	 	 	 	before. The intervals are measured with the 16 bits timer of
+ 	 	 	 	the port, periods over one turn of it are not measured
+ 	 \param[in] CAN Port, frame, FTM0 channel and period in microseconds
+ 	 \return 	MB used, CAN_NO_MB when there is no free message buffer
+ */
+uint8_t CAN_TriggerStart(PortCAN_t portCAN, const CAN_Frame_t* frame, uint8_t channel, uint32_t periodUs);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Change the data of a triggered frame, the next launch sends it
+ 	 \param[in] FTM0 channel and data words
+ 	 \return 	1 when written, 0 while the previous frame is pending
+ */
+uint8_t CAN_TriggerUpdate(uint8_t channel, uint32_t dataWord1, uint32_t dataWord2);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Metrics of a triggered frame
+ 	 \param[in] FTM0 channel and structure where the metrics are saved
+ 	 \return 	Void
+ */
+void CAN_TriggerGetStats(uint8_t channel, CAN_TriggerStats_t* stats);
+
+#endif /* CAN_TRIGGER_H_ */
@@ -0,0 +1,259 @@
+/**
+ *	\file	CAN_TxQueue.c
+ *	\brief
+ *			Priority classes of TX frames fed to the TX pool by the TX
+ *			interrupt.
+ */
+
+#include <stddef.h>
+#include "S32K144.h"
+#include "CAN.h"
+#include "CAN_Critical.h"
+#include "CAN_TxQueue.h"
+
+#define TXQ_NO_CLASS		(0xFF)		/*Slot of the pool not fed by the queues*/
+#define TXQ_RESERVED		(1)			/*MBs of the pool kept for the classes above when inflight is 0*/
+
+/*Frame waiting in a class*/
+typedef struct
+{
+	CAN_Frame_t		frame;
+	CAN_TxOptions_t	options;
+	uint8_t			hasOptions;		/*0 sends with the defaults of CAN_Send*/
+	uint32_t		queuedAt;		/*Time of CAN_TxQueueSend*/
+} TxEntry_t;
+
+/*Queues of a port*/
+typedef struct
+{
+	TxEntry_t			entry[CAN_TXQ_CLASSES][CAN_TXQ_DEPTH];
+	uint32_t			head[CAN_TXQ_CLASSES];
+	uint32_t			tail[CAN_TXQ_CLASSES];
+	CAN_TxClass_t		cls[CAN_TXQ_CLASSES];
+	uint8_t				credit[CAN_TXQ_CLASSES];	/*Frames left in the round of TXQ_WRR*/
+	uint8_t				inflight[CAN_TXQ_CLASSES];	/*MBs of the pool held by the class*/
+	uint8_t				slotClass[CAN_TX_POOL_SIZE];	/*Class of the frame of each MB*/
+	uint8_t				current;					/*Class served by the round*/
+	uint8_t				configured;					/*slotClass initialized*/
+	CAN_TxQueuePolicy_t	policy;
+} TxQueues_t;
+
+static TxQueues_t txq[CAN_INSTANCE_COUNT];
+static CAN_TxQueueStats_t txqStats[CAN_INSTANCE_COUNT][CAN_TXQ_CLASSES];
+
+/*Give back the MBs whose frames are finished*/
+static void CAN_TxQueueRelease(PortCAN_t portCAN)
+{
+	TxQueues_t *q = &txq[portCAN];
+	CAN_TxStatus_t status;
+	uint8_t slot;
+
+	for (slot = 0; slot < CAN_TX_POOL_SIZE; slot++)
+	{
+		if (TXQ_NO_CLASS == q->slotClass[slot])
+			continue;
+
+		status = CAN_GetTxStatus(portCAN, slot);
+		if ((TX_PENDING != status) && (TX_ABORTING != status))
+		{
+			q->inflight[q->slotClass[slot]]--;
+			q->slotClass[slot] = TXQ_NO_CLASS;
+		}
+	}
+}
+
+/*MBs a class can hold, by default the classes under 0 leave MBs to the ones above*/
+static uint8_t CAN_TxQueueLimit(const TxQueues_t* q, uint8_t cls)
+{
+	if (q->cls[cls].inflight)
+		return q->cls[cls].inflight;
+
+	return cls ? (CAN_TX_POOL_SIZE - TXQ_RESERVED) : CAN_TX_POOL_SIZE;
+}
+
+/*A class can send when it has frames and MBs left*/
+static uint8_t CAN_TxQueueReady(const TxQueues_t* q, uint8_t cls)
+{
+	return (q->head[cls] != q->tail[cls]) && (q->inflight[cls] < CAN_TxQueueLimit(q, cls));
+}
+
+/*Class of the next frame, CAN_TXQ_CLASSES when none can send*/
+static uint8_t CAN_TxQueuePick(TxQueues_t* q)
+{
+	uint8_t cls;
+	uint8_t turn;
+	uint8_t round;
+
+	if (TXQ_STRICT == q->policy)
+	{
+		for (cls = 0; cls < CAN_TXQ_CLASSES; cls++)
+		{
+			if (CAN_TxQueueReady(q, cls))
+				return cls;
+		}
+		return CAN_TXQ_CLASSES;
+	}
+
+	/*The round is restarted once when every ready class spent its weight*/
+	for (round = 0; round < 2; round++)
+	{
+		for (turn = 0; turn < CAN_TXQ_CLASSES; turn++)
+		{
+			cls = (q->current + turn) % CAN_TXQ_CLASSES;
+			if (q->credit[cls] && CAN_TxQueueReady(q, cls))
+			{
+				q->credit[cls]--;
+				q->current = q->credit[cls] ? cls : ((cls + 1) % CAN_TXQ_CLASSES);
+				return cls;
+			}
+		}
+
+		for (cls = 0; cls < CAN_TXQ_CLASSES; cls++)
+			q->credit[cls] = q->cls[cls].weight ? q->cls[cls].weight : 1;
+	}
+
+	return CAN_TXQ_CLASSES;
+}
+
+/*Fill the free MBs of the pool, refill of the TX interrupt*/
+static void CAN_TxQueueFeed(PortCAN_t portCAN)
+{
+	TxQueues_t *q = &txq[portCAN];
+	CAN_TxQueueStats_t *stats;
+	TxEntry_t *entry;
+	uint32_t irqState;
+	uint32_t now;
+	uint8_t handle;
+	uint8_t cls;
+
+	/*The frames wait for CAN_TxQueueConfig*/
+	if (!q->configured)
+		return;
+
+	irqState = CAN_EnterCritical();
+	CAN_TxQueueRelease(portCAN);
+	now = CAN_GetTime(portCAN);
+
+	for (cls = CAN_TxQueuePick(q); cls < CAN_TXQ_CLASSES; cls = CAN_TxQueuePick(q))
+	{
+		entry = &q->entry[cls][q->tail[cls] & (CAN_TXQ_DEPTH - 1)];
+		handle = CAN_Send(portCAN, &entry->frame, entry->hasOptions ? &entry->options : NULL);
+
+		/*The frame stays first in its class until an MB is released*/
+		if (CAN_TX_POOL_FULL == handle)
+		{
+			if (TXQ_WRR == q->policy)
+			{
+				q->credit[cls]++;
+				q->current = cls;
+			}
+			break;
+		}
+
+		stats = &txqStats[portCAN][cls];
+		q->tail[cls]++;
+		stats->depth--;
+
+		if (handle < CAN_TX_POOL_SIZE)
+		{
+			q->slotClass[handle] = cls;
+			q->inflight[cls]++;
+		}
+
+		/*A frame deferred by the admission check left the queue as sent*/
+		if (CAN_TX_DROPPED == handle)
+		{
+			stats->dropped++;
+		}
+		else
+		{
+			stats->sent++;
+			stats->wait = now - entry->queuedAt;
+			if (stats->wait > stats->waitMax)
+				stats->waitMax = stats->wait;
+		}
+	}
+	CAN_ExitCritical(irqState);
+}
+
+void CAN_TxQueueConfig(PortCAN_t portCAN, CAN_TxQueuePolicy_t policy, const CAN_TxClass_t* classes)
+{
+	TxQueues_t *q = &txq[portCAN];
+	uint32_t irqState;
+	uint8_t cls;
+	uint8_t slot;
+
+	irqState = CAN_EnterCritical();
+	for (cls = 0; cls < CAN_TXQ_CLASSES; cls++)
+	{
+		q->cls[cls] = classes[cls];
+		q->credit[cls] = classes[cls].weight ? classes[cls].weight : 1;
+	}
+	if (!q->configured)
+	{
+		for (slot = 0; slot < CAN_TX_POOL_SIZE; slot++)
+			q->slotClass[slot] = TXQ_NO_CLASS;
+		q->configured = 1;
+	}
+	q->current = 0;
+	q->policy = policy;
+	CAN_ExitCritical(irqState);
+
+	CAN_SetTxRefill(portCAN, CAN_TxQueueFeed);
+}
+
+uint8_t CAN_TxQueueSend(PortCAN_t portCAN, uint8_t cls, const CAN_Frame_t* frame, const CAN_TxOptions_t* options)
+{
+	TxQueues_t *q = &txq[portCAN];
+	CAN_TxQueueStats_t *stats;
+	TxEntry_t *entry;
+	uint32_t irqState;
+	uint8_t queued = 0;
+
+	if (cls >= CAN_TXQ_CLASSES)
+		return 0;
+	stats = &txqStats[portCAN][cls];
+
+	irqState = CAN_EnterCritical();
+	if ((q->head[cls] - q->tail[cls]) < CAN_TXQ_DEPTH)
+	{
+		entry = &q->entry[cls][q->head[cls] & (CAN_TXQ_DEPTH - 1)];
+		entry->frame = *frame;
+		entry->hasOptions = (NULL != options) ? 1 : 0;
+		if (NULL != options)
+			entry->options = *options;
+		entry->queuedAt = CAN_GetTime(portCAN);
+		q->head[cls]++;
+
+		stats->queued++;
+		stats->depth++;
+		if (stats->depth > stats->depthMax)
+			stats->depthMax = stats->depth;
+		queued = 1;
+	}
+	else
+	{
+		stats->dropped++;
+	}
+	CAN_ExitCritical(irqState);
+
+	/*An MB free now takes the frame without waiting for the TX interrupt*/
+	if (queued)
+		CAN_TxQueueFeed(portCAN);
+
+	return queued;
+}
+
+uint8_t CAN_TxQueueGetStats(PortCAN_t portCAN, uint8_t cls, CAN_TxQueueStats_t* stats)
+{
+	uint32_t irqState;
+
+	if (cls >= CAN_TXQ_CLASSES)
+		return 0;
+
+	irqState = CAN_EnterCritical();
+	*stats = txqStats[portCAN][cls];
+	CAN_ExitCritical(irqState);
+
+	return 1;
+}
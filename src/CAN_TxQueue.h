@@ -0,0 +1,75 @@
+/**
+ *	\file	CAN_TxQueue.h
+ *	\brief
+ *			Software TX queues of priority classes in front of the TX
+ *			pool. The TX interrupt fills each MB it releases from the
+ *			queues, by strict priority (class 0 first) or by weighted
+ *			round robin. A class can be kept under a number of MBs of the
+ *			pool so its frames never take the MBs of the classes above.
+ */
+
+#ifndef CAN_TXQUEUE_H_
+#define CAN_TXQUEUE_H_
+
+#include "CAN.h"
+
+#define CAN_TXQ_CLASSES		(4)		/*Classes per port, 0 is the highest*/
+#define CAN_TXQ_DEPTH		(16)	/*Frames queued per class, power of 2*/
+
+/*Order of the classes*/
+typedef enum {TXQ_STRICT, TXQ_WRR} CAN_TxQueuePolicy_t;
+
+/*Class of frames*/
+typedef struct
+{
+	uint8_t		weight;		/*Frames per round of TXQ_WRR, 0 counts as 1*/
+	uint8_t		inflight;	/*MBs of the pool the class can hold, 0 for the whole pool in class 0
+							  and all but one MB in the other classes, kept for the classes above*/
+} CAN_TxClass_t;
+
+/*Metrics of a class, the waits are in bit times from the queue to the TX pool*/
+typedef struct
+{
+	uint32_t	queued;		/*Frames taken by CAN_TxQueueSend*/
+	uint32_t	sent;		/*Frames given to CAN_Send*/
+	uint32_t	dropped;	/*Frames of a full queue or dropped by the admission check*/
+	uint32_t	depth;		/*Frames in the queue*/
+	uint32_t	depthMax;	/*Deepest queue*/
+	uint32_t	wait;		/*Wait of the last frame sent*/
+	uint32_t	waitMax;	/*Longest wait*/
+} CAN_TxQueueStats_t;
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Feed the TX pool of a port from the queues, the refill of
+ 	 	 	 	the TX interrupt is taken. Frames sent with CAN_Send still
+ 	 	 	 	go straight to the pool
+ 	 \param[in] CAN Port, policy and CAN_TXQ_CLASSES classes
+ 	 \return 	Void
+ */
+void CAN_TxQueueConfig(PortCAN_t portCAN, CAN_TxQueuePolicy_t policy, const CAN_TxClass_t* classes);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Queue a frame in a class, it goes to the pool at once when
+ 	 	 	 	an MB is free for it
+ 	 \param[in] CAN Port, class, frame and options (NULL for the defaults)
+ 	 \return 	1 when queued, 0 when the queue is full or the class does not exist
+ */
+uint8_t CAN_TxQueueSend(PortCAN_t portCAN, uint8_t cls, const CAN_Frame_t* frame, const CAN_TxOptions_t* options);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Metrics of a class
+ 	 \param[in] CAN Port, class and structure where the metrics are saved
+ 	 \return 	1 when saved, 0 when the class does not exist
+ */
+uint8_t CAN_TxQueueGetStats(PortCAN_t portCAN, uint8_t cls, CAN_TxQueueStats_t* stats);
+
+#endif /* CAN_TXQUEUE_H_ */
@@ -0,0 +1,107 @@
+/**
+ *	\file	CAN_Wait.c
+ *	\brief
+ *			Receive with a timeout, the core sleeps in WFI.
+ */
+
+#include "S32K144.h"
+#include "CAN.h"
+#include "CAN_Critical.h"
+#include "CAN_Wait.h"
+#include "LPIT.h"
+
+#define TIMER_MASK			(0x0000FFFF)	/*Bits of the stamp of the frames*/
+
+static uint8_t waitChannel;						/*LPIT channel of the timeouts*/
+static volatile uint8_t waitExpired;			/*Set by the timeout*/
+static CAN_WaitStats_t waitStats[CAN_INSTANCE_COUNT];
+
+/*End of the timeout, the interrupt itself wakes the core*/
+static void CAN_WaitTimeout(void)
+{
+	waitExpired = 1;
+}
+
+void CAN_WaitInit(uint8_t channel)
+{
+	waitChannel = channel;
+
+	/*Sleep, not deep sleep: the clocks of FlexCAN and LPIT keep running*/
+	S32_SCB->SCR &= ~S32_SCB_SCR_SLEEPDEEP_MASK;
+}
+
+uint8_t CAN_ReceiveTimeout(PortCAN_t portCAN, Rx_t* frame, uint32_t timeoutUs)
+{
+	CAN_WaitStats_t *stats = &waitStats[portCAN];
+	uint32_t irqState;
+	uint32_t before;
+	uint32_t slice;
+
+	if (CAN_Receive(portCAN, frame))
+		return 1;
+	if (0 == timeoutUs)
+		return 0;
+
+	/*A timeout longer than the LPIT counter is waited in slices*/
+	slice = (timeoutUs > LPIT_MAX_US) ? LPIT_MAX_US : timeoutUs;
+	timeoutUs -= slice;
+
+	stats->waits++;
+	waitExpired = 0;
+	LPIT_StartOnce(waitChannel, slice, CAN_WaitTimeout);
+
+	for (;;)
+	{
+		if (waitExpired && timeoutUs)
+		{
+			slice = (timeoutUs > LPIT_MAX_US) ? LPIT_MAX_US : timeoutUs;
+			timeoutUs -= slice;
+			waitExpired = 0;
+			LPIT_StartOnce(waitChannel, slice, CAN_WaitTimeout);
+		}
+
+		/*A FIFO left to the polls has its interrupt masked, its frames can not wake the core*/
+		CAN_RxNapiPoll(portCAN);
+
+		/*With PRIMASK set WFI still returns on a pending interrupt, the check and the
+		  sleep can not miss the interrupt of the frame*/
+		irqState = CAN_EnterCriticalAll();
+		if (CAN_GetRxBacklog(portCAN) || waitExpired)
+		{
+			CAN_ExitCriticalAll(irqState);
+			break;
+		}
+
+		before = CAN_GetTime(portCAN);
+		__asm volatile ("wfi" : : : "memory");
+		stats->asleep += CAN_GetTime(portCAN) - before;
+		stats->wakeups++;
+
+		/*The interrupt that woke the core runs here*/
+		CAN_ExitCriticalAll(irqState);
+	}
+
+	LPIT_Stop(waitChannel);
+
+	if (!CAN_Receive(portCAN, frame))
+	{
+		stats->timeouts++;
+		return 0;
+	}
+
+	stats->frames++;
+	stats->latency = (CAN_GetTime(portCAN) - frame->RxTimeStamp) & TIMER_MASK;
+	if (stats->latency > stats->latencyMax)
+		stats->latencyMax = stats->latency;
+
+	return 1;
+}
+
+void CAN_WaitGetStats(PortCAN_t portCAN, CAN_WaitStats_t* stats)
+{
+	uint32_t irqState;
+
+	irqState = CAN_EnterCritical();
+	*stats = waitStats[portCAN];
+	CAN_ExitCritical(irqState);
+}
@@ -0,0 +1,62 @@
+/**
+ *	\file	CAN_Wait.h
+ *	\brief
+ *			Blocking receive that sleeps the core. The caller waits in
+ *			WFI until the RX interrupt queues a frame in the RX ring or
+ *			a LPIT channel ends the timeout, the CAN ports keep running
+ *			while the core sleeps.
+ */
+
+#ifndef CAN_WAIT_H_
+#define CAN_WAIT_H_
+
+#include "CAN.h"
+
+/*Metrics of the waits of a port, the times are in bit times of the port*/
+typedef struct
+{
+	uint32_t	waits;			/*Calls that had to sleep*/
+	uint32_t	frames;			/*Waits ended by a frame*/
+	uint32_t	timeouts;		/*Waits ended by the timer*/
+	uint32_t	wakeups;		/*Returns of WFI, other interrupts included*/
+	uint32_t	asleep;			/*Time spent in WFI*/
+	uint32_t	latency;		/*From the reception of the last frame to its return*/
+	uint32_t	latencyMax;		/*Longest latency*/
+} CAN_WaitStats_t;
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Select the LPIT channel of the timeouts, LPIT_init must be
+ 	 	 	 	called before
+ 	 \param[in] LPIT channel
+ 	 \return 	Void
+ */
+void CAN_WaitInit(uint8_t channel);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Take a frame of the RX ring, sleeping until one arrives or
+ 	 	 	 	the timeout ends. Only one caller waits at a time, from the
+ 	 	 	 	main loop. The bottom half of a masked RX FIFO is run
+ 	 	 	 	before each sleep
+ 	 \param[in] CAN Port, frame where the data received is saved and
+ 	 	 	 	timeout in microseconds (0 does not wait)
+ 	 \return 	1 when a frame was taken, 0 on timeout
+ */
+uint8_t CAN_ReceiveTimeout(PortCAN_t portCAN, Rx_t* frame, uint32_t timeoutUs);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Metrics of the waits of a port
+ 	 \param[in] CAN Port and structure where the metrics are saved
+ 	 \return 	Void
+ */
+void CAN_WaitGetStats(PortCAN_t portCAN, CAN_WaitStats_t* stats);
+
+#endif /* CAN_WAIT_H_ */
@@ -0,0 +1,122 @@
+/**
+ *	\file	FTM.c
+ *	\brief
+ *			Output compare interrupts of FTM0. The counter runs free
+ *			over 16 bits and each channel moves its compare value by
+ *			the period, the time of a compare does not depend on the
+ *			delay of the interrupt before it.
+ */
+
+#include <stddef.h>
+#include "S32K144.h"
+#include "FTM.h"
+#include "CAN_Critical.h"
+
+#define FTM_CLKS_SYSTEM		(1)			/*Counter clocked by the FTM input clock*/
+#define FTM_BDM_RUN			(3)			/*Counter running in debug mode*/
+#define FTM_WRAP			(0x10000)	/*Ticks of a turn of the counter*/
+
+/*Compare of a channel*/
+typedef struct
+{
+	FTM_Callback_t	callback;
+	uint16_t		step;		/*Period modulo the turn of the counter*/
+	uint32_t		laps;		/*Whole turns of the counter in a period*/
+	uint32_t		lapsLeft;	/*Compares left before the callback*/
+} FTM_Channel_t;
+
+static FTM_Channel_t ftmChannel[FTM_CHANNELS];
+
+void FTM_init (void)
+{
+	PCC->PCCn[PCC_FTM0_INDEX] = PCC_PCCn_CGC_MASK;	/*Enable the clock*/
+
+	FTM0->MODE = FTM_MODE_WPDIS_MASK;				/*Write protection off*/
+	FTM0->SC = 0;
+	FTM0->CONF = FTM_CONF_BDMMODE(FTM_BDM_RUN);
+	FTM0->CNTIN = 0;
+	FTM0->MOD = FTM_MOD_MOD_MASK;
+	FTM0->CNT = 0;
+
+	FTM0->SC = FTM_SC_CLKS(FTM_CLKS_SYSTEM) | FTM_SC_PS(FTM_PRESCALER);
+}
+
+void FTM_Start (uint8_t channel, uint32_t periodUs, FTM_Callback_t callback)
+{
+	FTM_Channel_t *ch = &ftmChannel[channel];
+	uint32_t irq = (uint32_t)FTM0_Ch0_Ch1_IRQn + (channel >> 1);
+	uint32_t ticks = periodUs * FTM_TICKS_PER_US;
+
+	FTM_Stop(channel);
+
+	ch->callback = callback;
+	ch->step = (uint16_t)ticks;
+	ch->laps = ticks / FTM_WRAP;
+
+	/*A step of 0 reaches the compare after a whole turn*/
+	if (0 == ch->step)
+		ch->laps--;
+	ch->lapsLeft = ch->laps;
+
+	/*MSB:MSA = 01 and ELSB:ELSA = 00: output compare without pin*/
+	FTM0->CONTROLS[channel].CnV = (uint16_t)(FTM0->CNT + ch->step);
+	FTM0->CONTROLS[channel].CnSC = FTM_CnSC_MSA_MASK | FTM_CnSC_CHIE_MASK;
+	CAN_EnableIRQLevel(irq, CAN_TRIGGER_PRIORITY);
+}
+
+void FTM_Stop (uint8_t channel)
+{
+	FTM0->CONTROLS[channel].CnSC = 0;
+}
+
+uint16_t FTM_GetLate (uint8_t channel)
+{
+	return (uint16_t)(FTM0->CNT - FTM0->CONTROLS[channel].CnV);
+}
+
+/*Call the callback of a channel on its last compare, then move the compare*/
+static void FTM_Handler (uint8_t channel)
+{
+	FTM_Channel_t *ch = &ftmChannel[channel];
+
+	if (!(FTM0->CONTROLS[channel].CnSC & FTM_CnSC_CHF_MASK))
+		return;
+
+	if (0 == ch->lapsLeft)
+	{
+		if (NULL != ch->callback)
+			ch->callback(channel);
+
+		FTM0->CONTROLS[channel].CnV = (uint16_t)(FTM0->CONTROLS[channel].CnV + ch->step);
+		ch->lapsLeft = ch->laps;
+	}
+	else
+		ch->lapsLeft--;
+
+	/*CHF is cleared writing 0 after it was read as 1*/
+	FTM0->CONTROLS[channel].CnSC &= ~FTM_CnSC_CHF_MASK;
+}
+
+void FTM0_Ch0_Ch1_IRQHandler (void)
+{
+	FTM_Handler(0);
+	FTM_Handler(1);
+}
+
+void FTM0_Ch2_Ch3_IRQHandler (void)
+{
+	FTM_Handler(2);
+	FTM_Handler(3);
+}
+
+void FTM0_Ch4_Ch5_IRQHandler (void)
+{
+	FTM_Handler(4);
+	FTM_Handler(5);
+}
+
+void FTM0_Ch6_Ch7_IRQHandler (void)
+{
+	FTM_Handler(6);
+	FTM_Handler(7);
+}
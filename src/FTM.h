@@ -0,0 +1,56 @@
+#ifndef FTM_H_
+#define FTM_H_
+
+#define FTM_CHANNELS		(8)		/*Channels of FTM0*/
+#define FTM_CLOCK_MHZ		(80)	/*FTM input clock, the system clock*/
+#define FTM_PRESCALER		(3)		/*Counter clock divided by 8*/
+#define FTM_TICKS_PER_US	(FTM_CLOCK_MHZ >> FTM_PRESCALER)	/*100 ns per tick*/
+
+/*Called by the compare interrupt of a channel*/
+typedef void (*FTM_Callback_t)(uint8_t channel);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief		Enable FTM0 as a free running 16 bits counter of 100 ns
+ 	 \param[in] Void
+ 	 \return 	Void
+ */
+void FTM_init (void);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Start the output compare of a channel, the callback is
+ 	 	 	 	called on every period from the interrupt of the channel at
+ 	 	 	 	the highest priority of the NVIC. Periods over the 6.5 ms of
+ 	 	 	 	the counter take one more compare per wrap
+ 	 \param[in] Channel, period in microseconds (not 0) and callback
+ 	 \return 	Void
+ */
+void FTM_Start (uint8_t channel, uint32_t periodUs, FTM_Callback_t callback);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Stop the compare of a channel and clear its flag
+ 	 \param[in] Channel
+ 	 \return 	Void
+ */
+void FTM_Stop (uint8_t channel);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Ticks from the last compare of a channel to now, the delay
+ 	 	 	 	of its interrupt when called from the callback
+ 	 \param[in] Channel
+ 	 \return 	Ticks of 100 ns
+ */
+uint16_t FTM_GetLate (uint8_t channel);
+
+#endif /* FTM_H_ */
@@ -0,0 +1,246 @@
+/**
+ *	\file	FlexCan.hpp
+ *	\brief
+ *			C++ front-end of the CAN driver. The port and the layout of
+ *			the message buffers are template arguments, a layout that
+ *			does not fit in the port fails to build. The direct message
+ *			buffers of the layout are driven through the registers of
+ *			the port, the rest goes to the C driver.
+ *
+ *			constexpr flexcan::Layout bodyLayout = {2, 1, 4, true, 2};
+ *			typedef flexcan::FlexCan<CAN_0, bodyLayout> BodyCan;
+ */
+
+#ifndef FLEXCAN_HPP_
+#define FLEXCAN_HPP_
+
+#include "S32K144.h"
+#include "S32K144_features.h"
+#include "CAN.h"
+
+namespace flexcan
+{
+
+/*Message buffers of a port, declared at compile time*/
+struct Layout
+{
+	uint8_t	txDirect;	/*MBs written by transmit<N>, outside of the TX pool*/
+	uint8_t	rxDirect;	/*MBs polled by receive<N>, outside of the RX ring*/
+	uint8_t	rxFilters;	/*MBs left to CAN_AddRxFilter and CAN_AddRemoteResponse*/
+	bool	fifo;		/*RX FIFO of CAN_EnableAdaptiveRx in MB0-MB7*/
+	uint8_t	promoted;	/*MBs of the IDs promoted from the FIFO*/
+};
+
+/*Hardware of a port*/
+template <PortCAN_t Port> struct PortTraits;
+
+template <> struct PortTraits<CAN_0>
+{
+	static const uint32_t base = CAN0_BASE;
+	static const uint8_t mbCount = FEATURE_CAN0_MAX_MB_NUM;
+};
+
+template <> struct PortTraits<CAN_1>
+{
+	static const uint32_t base = CAN1_BASE;
+	static const uint8_t mbCount = FEATURE_CAN1_MAX_MB_NUM;
+};
+
+template <> struct PortTraits<CAN_2>
+{
+	static const uint32_t base = CAN2_BASE;
+	static const uint8_t mbCount = FEATURE_CAN2_MAX_MB_NUM;
+};
+
+/*MBs kept by the driver, the FIFO replaces the RX MB4 of CAN_Receiver*/
+constexpr uint32_t driverMBs(const Layout& layout)
+{
+	return CAN_TX_POOL_SIZE + (layout.fifo ? CAN_FIFO_MBS : 1);
+}
+
+constexpr uint32_t usedMBs(const Layout& layout)
+{
+	return driverMBs(layout) + layout.txDirect + layout.rxDirect + layout.rxFilters + layout.promoted;
+}
+
+/*Fields of the message buffers, the same values used by CAN.c*/
+const uint32_t CODE_MASK		= 0x0F000000;
+const uint32_t CODE_TX_DATA		= 0x0C000000;
+const uint32_t CODE_TX_INACTIVE	= 0x08000000;
+const uint32_t CODE_RX_INACTIVE	= 0x00000000;
+const uint32_t CODE_RX_EMPTY	= 0x04000000;
+const uint32_t CODE_RX_BUSY		= 0x01000000;
+const uint32_t SRR_TX			= 0x00400000;
+const uint32_t SHIFT_CODE		= 24;
+const uint32_t SHIFT_STD_ID		= 18;
+const uint32_t STAMP_MASK		= 0x0000FFFF;
+const uint32_t WORDS_PER_MB		= 4;
+
+template <PortCAN_t Port, const Layout& L>
+class FlexCan
+{
+	typedef PortTraits<Port> Traits;
+
+	static_assert(usedMBs(L) <= Traits::mbCount,
+			"the layout needs more message buffers than the port has");
+	static_assert(L.txDirect + L.rxDirect <= Traits::mbCount - (CAN_TX_POOL_FIRST + CAN_TX_POOL_SIZE),
+			"the direct message buffers must be above the TX pool");
+	static_assert(L.fifo || 0 == L.promoted,
+			"promoted IDs need the RX FIFO");
+#ifdef CAN_FIXED_PORT
+	static_assert(CAN_FIXED_PORT == Port,
+			"the driver is built for another port");
+#endif
+
+	/*Direct MBs from the top of the port, CAN_AllocMB gives the ones below*/
+	static constexpr uint8_t txMB(uint8_t n) { return Traits::mbCount - 1 - n; }
+	static constexpr uint8_t rxMB(uint8_t n) { return Traits::mbCount - 1 - L.txDirect - n; }
+
+	static CAN_Type* regs() { return reinterpret_cast<CAN_Type*>(Traits::base); }
+
+public:
+	/*!
+		\brief		Configure the port, take the direct message buffers and
+					enable the FIFO of the layout
+		\param[in]	Configuration of the driver
+		\return		Void
+	 */
+	static void init(const CAN_Config_t& config)
+	{
+		uint8_t n;
+
+		CAN_init(Port, &config);
+
+		for (n = 0; n < L.txDirect; n++)
+		{
+			(void)CAN_ClaimMB(Port, txMB(n));
+			regs()->RAMn[txMB(n) * WORDS_PER_MB] = CODE_TX_INACTIVE;
+		}
+		for (n = 0; n < L.rxDirect; n++)
+		{
+			(void)CAN_ClaimMB(Port, rxMB(n));
+			regs()->RAMn[rxMB(n) * WORDS_PER_MB] = CODE_RX_INACTIVE;
+		}
+
+		if (L.fifo)
+			(void)CAN_EnableAdaptiveRx(Port, L.promoted);
+	}
+
+	/*!
+		\brief		Write a frame in a direct TX message buffer
+		\param[in]	Frame to transmit
+		\return		false while the previous frame of the MB is pending
+	 */
+	template <uint8_t N>
+	static bool transmit(const CAN_Frame_t& frame)
+	{
+		static_assert(N < L.txDirect, "transmit<N> needs a direct TX message buffer N");
+		volatile uint32_t* mb = &regs()->RAMn[txMB(N) * WORDS_PER_MB];
+
+		if (CODE_TX_DATA == (mb[0] & CODE_MASK))
+			return false;
+
+		regs()->IFLAG1 = 1UL << txMB(N);
+		mb[0] = CODE_TX_INACTIVE;
+		mb[1] = frame.ID << SHIFT_STD_ID;
+		mb[2] = frame.Data[0];
+		mb[3] = frame.Data[1];
+		mb[0] = CODE_TX_DATA | SRR_TX | (frame.Length << CAN_WMBn_CS_DLC_SHIFT) |
+				(frame.Remote ? CAN_WMBn_CS_RTR_MASK : 0);
+
+		return true;
+	}
+
+	/*!
+		\brief		Accept one ID in a direct RX message buffer
+		\param[in]	Standard identifier
+		\return		Void
+	 */
+	template <uint8_t N>
+	static void listen(uint32_t ID)
+	{
+		static_assert(N < L.rxDirect, "listen<N> needs a direct RX message buffer N");
+		volatile uint32_t* mb = &regs()->RAMn[rxMB(N) * WORDS_PER_MB];
+
+		mb[0] = CODE_RX_INACTIVE;
+		mb[1] = ID << SHIFT_STD_ID;
+		mb[0] = CODE_RX_EMPTY;
+	}
+
+	/*!
+		\brief		Take the frame of a direct RX message buffer, RxTimeStamp
+					is the 16 bits stamp of the controller
+		\param[in]	Frame where the data received is saved
+		\return		true when a frame was taken
+	 */
+	template <uint8_t N>
+	static bool receive(Rx_t& frame)
+	{
+		static_assert(N < L.rxDirect, "receive<N> needs a direct RX message buffer N");
+		volatile uint32_t* mb = &regs()->RAMn[rxMB(N) * WORDS_PER_MB];
+		uint32_t cs;
+
+		if (!(regs()->IFLAG1 & (1UL << rxMB(N))))
+			return false;
+
+		/*Reading CS locks the MB until the timer is read, wait while it is being filled*/
+		do
+		{
+			cs = mb[0];
+		} while (cs & CODE_RX_BUSY);
+
+		frame.RxCode = (cs & CODE_MASK) >> SHIFT_CODE;
+		if (frame.RxCode & CAN_RX_FULL)
+		{
+			frame.RxID = (mb[1] & CAN_WMBn_ID_ID_MASK) >> SHIFT_STD_ID;
+			frame.RxLength = (cs & CAN_WMBn_CS_DLC_MASK) >> CAN_WMBn_CS_DLC_SHIFT;
+			frame.RxData[0] = mb[2];
+			frame.RxData[1] = mb[3];
+			frame.RxTimeStamp = cs & STAMP_MASK;
+			frame.RxRemote = (cs & CAN_WMBn_CS_RTR_MASK) ? 1 : 0;
+			frame.RxOwn = 0;
+		}
+
+		/*The flag is cleaned while no frame can be moved in*/
+		regs()->IFLAG1 = 1UL << rxMB(N);
+		(void)CAN_GetTime(Port);
+
+		/*The frame before this one was lost, counted with the MBs of the driver*/
+		if (CAN_RX_OVERRUN == frame.RxCode)
+			CAN_ReportOverrun(Port, rxMB(N));
+
+		return 0 != (frame.RxCode & CAN_RX_FULL);
+	}
+
+	/*Pooled paths of the C driver*/
+	static uint8_t send(const CAN_Frame_t& frame, const CAN_TxOptions_t* options = nullptr)
+	{
+		return CAN_Send(Port, &frame, options);
+	}
+
+	static bool receive(Rx_t& frame)
+	{
+		return 0 != CAN_Receive(Port, &frame);
+	}
+
+	static uint8_t addRxFilter(const CAN_RxFilter_t& filter)
+	{
+		return CAN_AddRxFilter(Port, &filter);
+	}
+
+	static void service()
+	{
+		CAN_TxService(Port);
+		if (L.fifo)
+			CAN_AdaptiveService(Port);
+	}
+
+	static uint32_t time()
+	{
+		return CAN_GetTime(Port);
+	}
+};
+
+}
+
+#endif /* FLEXCAN_HPP_ */
@@ -0,0 +1,93 @@
+/**
+ *	\file	LPIT.c
+ *	\brief
+ *			Periodic interrupts of the four channels of LPIT0.
+ */
+
+#include <stddef.h>
+#include "S32K144.h"
+#include "LPIT.h"
+#include "CAN_Critical.h"
+
+#define LPIT_PCS_SPLLDIV2	(6)				/*Clock source SPLL_DIV2 of the PCC*/
+
+static LPIT_Callback_t lpitCallback[LPIT_CHANNELS];	/*Callback of each channel*/
+
+void LPIT_init (void)
+{
+	PCC->PCCn[PCC_LPIT_INDEX] = PCC_PCCn_PCS(LPIT_PCS_SPLLDIV2);	/*Clock source while the gate is off*/
+	PCC->PCCn[PCC_LPIT_INDEX] |= PCC_PCCn_CGC_MASK;				/*Enable the clock*/
+
+	LPIT0->MCR = LPIT_MCR_M_CEN_MASK | LPIT_MCR_DBG_EN_MASK;		/*Run also in debug mode*/
+}
+
+/*Load a channel and start it with the control word given*/
+static void LPIT_Arm (uint8_t channel, uint32_t periodUs, LPIT_Callback_t callback, uint32_t tctrl)
+{
+	uint32_t irq = (uint32_t)LPIT0_Ch0_IRQn + channel;
+
+	LPIT_Stop(channel);
+
+	lpitCallback[channel] = callback;
+
+	/*The cycles of the period must fit in TVAL, 0 would wrap to the longest period*/
+	if (periodUs > LPIT_MAX_US)
+		periodUs = LPIT_MAX_US;
+	else if (0 == periodUs)
+		periodUs = LPIT_MIN_US;
+
+	/*The counter is loaded with TVAL and the flag is set after TVAL + 1 cycles*/
+	LPIT0->TMR[channel].TVAL = (periodUs * LPIT_CLOCK_MHZ) - 1;
+	LPIT0->MIER |= LPIT_MIER_TIE0_MASK << channel;
+	CAN_EnableIRQLevel(irq, CAN_IRQ_PRIORITY);		/*The callbacks send frames*/
+
+	LPIT0->TMR[channel].TCTRL = tctrl;
+}
+
+void LPIT_Start (uint8_t channel, uint32_t periodUs, LPIT_Callback_t callback)
+{
+	/*MODE = 0: 32 bits periodic counter*/
+	LPIT_Arm(channel, periodUs, callback, LPIT_TMR_TCTRL_T_EN_MASK);
+}
+
+void LPIT_StartOnce (uint8_t channel, uint32_t delayUs, LPIT_Callback_t callback)
+{
+	/*TSOI: the counter stops at the first timeout*/
+	LPIT_Arm(channel, delayUs, callback, LPIT_TMR_TCTRL_T_EN_MASK | LPIT_TMR_TCTRL_TSOI_MASK);
+}
+
+void LPIT_Stop (uint8_t channel)
+{
+	LPIT0->TMR[channel].TCTRL = 0;
+	LPIT0->MIER &= ~(LPIT_MIER_TIE0_MASK << channel);
+	LPIT0->MSR = LPIT_MSR_TIF0_MASK << channel;
+}
+
+/*Clear the flag and call the callback of the channel*/
+static void LPIT_Handler (uint8_t channel)
+{
+	LPIT0->MSR = LPIT_MSR_TIF0_MASK << channel;
+
+	if (NULL != lpitCallback[channel])
+		lpitCallback[channel]();
+}
+
+void LPIT0_Ch0_IRQHandler (void)
+{
+	LPIT_Handler(0);
+}
+
+void LPIT0_Ch1_IRQHandler (void)
+{
+	LPIT_Handler(1);
+}
+
+void LPIT0_Ch2_IRQHandler (void)
+{
+	LPIT_Handler(2);
+}
+
+void LPIT0_Ch3_IRQHandler (void)
+{
+	LPIT_Handler(3);
+}
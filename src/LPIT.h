@@ -0,0 +1,56 @@
+#ifndef LPIT_H_
+#define LPIT_H_
+
+#define LPIT_CHANNELS		(4)		/*Channels of LPIT0*/
+#define LPIT_CLOCK_MHZ		(40)	/*Functional clock, SPLL_DIV2*/
+#define LPIT_MIN_US			(1)		/*Shortest period*/
+#define LPIT_MAX_US			(0xFFFFFFFFUL / LPIT_CLOCK_MHZ)	/*Longest period of the 32 bits counter, about 107 s*/
+
+/*Called by the interrupt of a channel*/
+typedef void (*LPIT_Callback_t)(void);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief		Enable LPIT0 with the SPLL_DIV2 clock (40 MHz)
+ 	 \param[in] Void
+ 	 \return 	Void
+ */
+void LPIT_init (void);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Start a channel in periodic mode, the callback is called
+ 	 	 	 	from the interrupt of the channel on every period
+ 	 \param[in] Channel, period in microseconds (LPIT_MIN_US to LPIT_MAX_US,
+ 	 	 	 	other periods are clamped) and callback
+ 	 \return 	Void
+ */
+void LPIT_Start (uint8_t channel, uint32_t periodUs, LPIT_Callback_t callback);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Start a channel for a single timeout, the callback is called
+ 	 	 	 	once from the interrupt of the channel
+ 	 \param[in] Channel, delay in microseconds (LPIT_MIN_US to LPIT_MAX_US,
+ 	 	 	 	other delays are clamped) and callback
+ 	 \return 	Void
+ */
+void LPIT_StartOnce (uint8_t channel, uint32_t delayUs, LPIT_Callback_t callback);
+
+/********************************************************************************************/
+/********************************************************************************************/
+/********************************************************************************************/
+/*!
+ 	 \brief	 	Stop a channel and clear its pending interrupt
+ 	 \param[in] Channel
+ 	 \return 	Void
+ */
+void LPIT_Stop (uint8_t channel);
+
+#endif /* LPIT_H_ */
@@ -10,14 +10,32 @@
  *	\date	27/03/2019
  */
 
+#include <stddef.h>
 #include "S32K144.h"
 #include "CAN.h"
+#include "CAN_Service.h"
+#include "CAN_Cyclic.h"
+#include "CAN_Trigger.h"
+#include "CAN_Defer.h"
+#include "LPIT.h"
+#include "FTM.h"
 #include "LPSPI.h"
 #include "GPIO.h"
 #include "clock_and_modes.h"
 
 #define DATA_WORD_1			(0xA5112233)	/*Data word 1 to transmit*/
 #define DATA_WORD_2			(0x44556677)	/*Data word 2 to transmit*/
+#define DLC_BYTES			(8)				/*Length of the cyclic frames*/
+#define SERVICE_QUOTA		(8)				/*Frames of each port per turn of the service*/
+#define CYCLIC_ID			(0x555)			/*ID of the cyclic frame of each port*/
+#define CYCLIC_TICK_US		(1000)			/*Tick of the cyclic scheduler*/
+#define CYCLIC_PERIOD		(10)			/*Ticks between two frames of a port*/
+#define CYCLIC_CHANNEL		(0)				/*LPIT channel of the scheduler*/
+#define TRIGGER_ID			(0x080)			/*ID of the time triggered frame*/
+#define TRIGGER_PERIOD_US	(10000)			/*Period of the time triggered frame*/
+#define TRIGGER_CHANNEL		(0)				/*FTM0 channel launching it*/
+#define REMOTE_ID			(0x321)			/*ID of the remote request checked at start up*/
+#define REMOTE_TIMEOUT		(2000)			/*Bit times left to the answer of the remote request*/
 
 
 /*Pointer that saves the information about the configuration about the CAN frame*/
@@ -28,30 +46,110 @@ const CAN_Config_t	CAN_Config =
 	{7,					/*Propagation Segment*/
 	4,					/*Phase 1 Segment*/
 	4,					/*Phase 2 Segment*/
-	1}					/*Sampling bit*/
+	1},					/*Sampling bit*/
+	REMOTE_ANSWER,		/*Remote requests answered by the response MBs*/
+	SELF_RX_TAG			/*Own frames received with RxOwn set, needed by the loopback*/
 };
 
+uint32_t	gatewayData[CAN_INSTANCE_COUNT][2];	/*Last data received by each port*/
+uint8_t		remoteAnswered;						/*1 when the remote request of CAN_1 was answered*/
+
+/*Handler of the frames of the three ports*/
+static void GatewayRx(PortCAN_t portCAN, const Rx_t* frame)
+{
+	gatewayData[portCAN][0] = frame->RxData[0];
+	gatewayData[portCAN][1] = frame->RxData[1];
+}
+
+/*In loopback the port answers its own remote request, the answer is matched by the TX MB of the request and must reach the RX ring*/
+static uint8_t RemoteCheck(PortCAN_t portCAN)
+{
+	CAN_Frame_t request = {REMOTE_ID, DLC_BYTES, {0, 0}, 1};
+	CAN_Frame_t response = {REMOTE_ID, DLC_BYTES, {DATA_WORD_1, DATA_WORD_2}, 0};
+	CAN_TxOptions_t options = {REMOTE_TIMEOUT, TX_RETRY, 0};
+	CAN_TxStatus_t status;
+	Rx_t answer;
+	uint8_t handle;
+
+	if (CAN_NO_MB == CAN_AddRemoteResponse(portCAN, &response))
+		return 0;
+
+	handle = CAN_Send(portCAN, &request, &options);
+	if (CAN_TX_POOL_SIZE <= handle)
+		return 0;
+
+	/*The request is done when the answer is in, TX_TIMEOUT without answer*/
+	do
+	{
+		CAN_TxService(portCAN);
+		status = CAN_GetTxStatus(portCAN, handle);
+	} while (TX_PENDING == status);
+
+	return (TX_DONE == status) && CAN_Receive(portCAN, &answer) && (REMOTE_ID == answer.RxID) && !answer.RxRemote &&
+			(DATA_WORD_1 == answer.RxData[0]) && (DATA_WORD_2 == answer.RxData[1]);
+}
+
 int main(void)
 {
+	CAN_Cyclic_t cyclic =
+	{
+		CAN_0,
+		{CYCLIC_ID, DLC_BYTES, {DATA_WORD_1, DATA_WORD_2}, 0},
+		CYCLIC_PERIOD,
+		0
+	};
+	CAN_Frame_t triggered = {TRIGGER_ID, DLC_BYTES, {DATA_WORD_1, DATA_WORD_2}, 0};
+	uint8_t port;
+
 	WDOG_disable();					/*Disable the watchdog*/
 	ClockConfig();					/*Configure the clock*/
 
 	CAN_init(CAN_0, &CAN_Config);	/* Init FlexCAN0 */
+	CAN_init(CAN_1, &CAN_Config);	/* Init FlexCAN1 */
+	CAN_init(CAN_2, &CAN_Config);	/* Init FlexCAN2 */
 	PORT_init(CAN_0, PORT_E);             	/* Configure ports */
+	PORT_init(CAN_1, PORT_C);
+	PORT_init(CAN_2, PORT_C);
+
+	/*Before the service reads the RX ring of the port*/
+	remoteAnswered = RemoteCheck(CAN_1);
+
+	/*The handlers of the ports run from PendSV*/
+	CAN_DeferInit();
+	(void)CAN_SetDeferred(CAN_0, 1);
+	(void)CAN_SetDeferred(CAN_1, 1);
+	(void)CAN_SetDeferred(CAN_2, 1);
+
+	CAN_ServiceAddPort(CAN_0, SERVICE_QUOTA, GatewayRx);
+	CAN_ServiceAddPort(CAN_1, SERVICE_QUOTA, GatewayRx);
+	CAN_ServiceAddPort(CAN_2, SERVICE_QUOTA, GatewayRx);
 
 #ifdef SBC_MC33903 					/* SPI and transceiver initialization is required */
 	  LPSPI1_init_master(); 		/* Initialize LPSPI1 for communication with MC33903 */
 	  LPSPI1_init_MC33903(); 		/* Configure SBC via SPI for CAN transceiver operation */
 #endif
 
-	  uint32_t *dataReceived1;		/*Data to save the information from RX*/
-	  uint32_t *dataReceived2;		/*Data to save the information from RX*/
+	/*The ports send in different ticks*/
+	LPIT_init();
+	for (port = 0; port < CAN_INSTANCE_COUNT; port++)
+	{
+		cyclic.port = (PortCAN_t)port;
+		cyclic.offset = port * (CYCLIC_PERIOD / CAN_INSTANCE_COUNT);
+		(void)CAN_CyclicAdd(&cyclic);
+	}
+	CAN_CyclicStart(CYCLIC_CHANNEL, CYCLIC_TICK_US);
+
+	/*Launched by the FTM0 compare, outside of the TX pool*/
+	FTM_init();
+	(void)CAN_TriggerStart(CAN_0, &triggered, TRIGGER_CHANNEL, TRIGGER_PERIOD_US);
+
+	  uint32_t dataReceived1;		/*Data to save the information from RX*/
+	  uint32_t dataReceived2;		/*Data to save the information from RX*/
 
 	  for(;;)
 	  {
-		  delay(5000);
-		  CAN_Transmitter(CAN_0, DATA_WORD_1, DATA_WORD_2);
-		  CAN_Receiver (CAN_0, dataReceived1, dataReceived2);
+		  CAN_Receiver (CAN_0, &dataReceived1, &dataReceived2);
+		  (void)CAN_ServicePoll();	/*Release the TX pools and drain the RX rings*/
 	  }
 
 	return 0;
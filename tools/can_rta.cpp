@@ -0,0 +1,240 @@
+/**
+ *	\file	can_rta.cpp
+ *	\brief
+ *			Worst case response time analysis of a CAN message set, run
+ *			on the host before a new catalogue is deployed. The frames
+ *			are queued with fixed priority (lower ID first) and the
+ *			analysis is the one of Davis, Burns, Bril and Lukkien (2007):
+ *			blocking by the longest lower priority frame, interference
+ *			of the higher priority frames with their queuing jitter and
+ *			every instance of the level-m busy period checked.
+ *
+ *			gcc -c -O2 -Iinclude -Isrc src/CAN_Offset.c
+ *			g++ -std=c++11 -O2 -Iinclude -Isrc tools/can_rta.cpp CAN_Offset.o -o can_rta
+ *			./can_rta B500KHZ < catalogue.txt
+ *
+ *			One message per line: "ID DLC PERIOD_US [JITTER_US [DEADLINE_US]]",
+ *			hexadecimal standard ID (up to 7FF), the deadline is the
+ *			period when it is not given. Lines starting with '#' are
+ *			comments. The exit code is
+ *			1 when a frame misses its deadline or the bus is overloaded,
+ *			2 for a bad catalogue (an ID given twice or over 7FF included).
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <iostream>
+#include "CAN_Offset.h"
+
+namespace
+{
+
+const uint32_t STD_ID_MAX = 0x7FF;	/*Highest standard identifier*/
+
+/*Bit rates of bitTime_t in CAN.h*/
+struct BitRate
+{
+	const char	*name;
+	uint32_t	bitsPerSecond;
+};
+
+const BitRate bitRates[] =
+{
+	{"B10KHZ", 10000},
+	{"B20KHZ", 20000},
+	{"B50KHZ", 50000},
+	{"B125KHZ", 125000},
+	{"B250KHZ", 250000},
+	{"B500KHZ", 500000},
+	{"B800KHZ", 800000},
+	{"B1MHZ", 1000000}
+};
+
+/*Message of the catalogue, the times are in bit times*/
+struct Message
+{
+	uint32_t	id;
+	uint32_t	dlc;
+	int64_t		period;
+	int64_t		jitter;
+	int64_t		deadline;
+	int64_t		length;		/*Worst case bits of the frame*/
+	int64_t		blocking;	/*Longest lower priority frame*/
+	int64_t		response;	/*Worst case response time, -1 when unbounded*/
+};
+
+int64_t ceilDiv(int64_t a, int64_t b)
+{
+	return (a + b - 1) / b;
+}
+
+/*Interference of the messages before m in a window*/
+int64_t interference(const std::vector<Message>& set, size_t m, int64_t window)
+{
+	int64_t sum = 0;
+
+	for (size_t k = 0; k < m; k++)
+		sum += ceilDiv(window + set[k].jitter, set[k].period) * set[k].length;
+
+	return sum;
+}
+
+/*Response time of the message m, the set is sorted by priority and the utilization is under 1.
+  The first instance found over the deadline is returned, the rest are not needed*/
+int64_t responseTime(const std::vector<Message>& set, size_t m)
+{
+	const Message& msg = set[m];
+	int64_t busy = msg.length;
+	int64_t next;
+	int64_t worst = 0;
+
+	/*Level-m busy period, the frames of m included*/
+	for (;;)
+	{
+		next = msg.blocking + interference(set, m + 1, busy);
+		if (next == busy)
+			break;
+		busy = next;
+	}
+
+	int64_t instances = ceilDiv(busy + msg.jitter, msg.period);
+	int64_t wait = msg.blocking;
+
+	for (int64_t q = 0; q < instances; q++)
+	{
+		/*Queuing delay of the instance q, one bit of the higher priority frames counted in*/
+		for (;;)
+		{
+			next = msg.blocking + (q * msg.length) + interference(set, m, wait + 1);
+			if (next == wait)
+				break;
+			wait = next;
+			if ((msg.jitter + wait - (q * msg.period) + msg.length) > msg.deadline)
+				return msg.jitter + wait - (q * msg.period) + msg.length;
+		}
+
+		worst = std::max(worst, msg.jitter + wait - (q * msg.period) + msg.length);
+	}
+
+	return worst;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+	const BitRate *rate = nullptr;
+
+	for (const BitRate& candidate : bitRates)
+	{
+		if ((argc > 1) && (0 == std::strcmp(argv[1], candidate.name)))
+			rate = &candidate;
+	}
+	if (nullptr == rate)
+	{
+		std::fprintf(stderr, "usage: %s B10KHZ|B20KHZ|B50KHZ|B125KHZ|B250KHZ|B500KHZ|B800KHZ|B1MHZ < catalogue\n", argv[0]);
+		return 2;
+	}
+
+	/*Microseconds to bit times, rounded to the pessimistic side: period and deadline down, jitter up*/
+	auto bitsDown = [rate](double us) { return static_cast<int64_t>(us * rate->bitsPerSecond / 1e6 + 0.000001); };
+	auto bitsUp = [rate](double us) { return static_cast<int64_t>(us * rate->bitsPerSecond / 1e6 + 0.999999); };
+
+	std::vector<Message> set;
+	std::string line;
+
+	while (std::getline(std::cin, line))
+	{
+		if (line.empty() || ('#' == line[0]))
+			continue;
+
+		std::istringstream fields(line);
+		Message msg = Message();
+		double period = 0;
+		double jitter = 0;
+		double deadline = 0;
+
+		if (!(fields >> std::hex >> msg.id >> std::dec >> msg.dlc >> period) || (period <= 0))
+		{
+			std::fprintf(stderr, "bad line: %s\n", line.c_str());
+			return 2;
+		}
+		fields >> jitter >> deadline;
+
+		msg.period = bitsDown(period);
+		msg.jitter = bitsUp(jitter);
+		msg.deadline = bitsDown((deadline > 0) ? deadline : period);
+		msg.length = CAN_FrameBitsMax(msg.dlc);
+		if (msg.period <= 0)
+		{
+			std::fprintf(stderr, "period shorter than one bit: %s\n", line.c_str());
+			return 2;
+		}
+
+		/*The lengths and the priorities are the ones of standard frames, like the driver*/
+		if (msg.id > STD_ID_MAX)
+		{
+			std::fprintf(stderr, "extended ID not supported: %s\n", line.c_str());
+			return 2;
+		}
+		set.push_back(msg);
+	}
+
+	/*Lower ID wins the arbitration*/
+	std::sort(set.begin(), set.end(), [](const Message& a, const Message& b) { return a.id < b.id; });
+
+	/*Two senders of one ID collide in the arbitration, the analysis assumes unique priorities*/
+	for (size_t m = 1; m < set.size(); m++)
+	{
+		if (set[m].id == set[m - 1].id)
+		{
+			std::fprintf(stderr, "ID 0x%03X given twice\n", set[m].id);
+			return 2;
+		}
+	}
+
+	double utilization = 0;
+	for (const Message& msg : set)
+		utilization += static_cast<double>(msg.length) / msg.period;
+
+	/*Blocking is the longest frame after m, one pass from the lowest priority*/
+	int64_t longest = 0;
+	for (size_t m = set.size(); m > 0; m--)
+	{
+		set[m - 1].blocking = longest;
+		longest = std::max(longest, set[m - 1].length);
+	}
+
+	size_t failed = 0;
+
+	std::printf("%-6s %4s %10s %10s %10s %10s  %s\n", "ID", "DLC", "C[us]", "B[us]", "R[us]", "D[us]", "result");
+	for (size_t m = 0; m < set.size(); m++)
+	{
+		Message& msg = set[m];
+
+		/*The busy period is unbounded on an overloaded bus*/
+		msg.response = (utilization < 1.0) ? responseTime(set, m) : -1;
+
+		bool pass = (msg.response >= 0) && (msg.response <= msg.deadline);
+		if (!pass)
+			failed++;
+
+		auto toUs = [rate](int64_t bits) { return bits * 1e6 / rate->bitsPerSecond; };
+		std::printf("0x%03X  %4u %10.1f %10.1f ", msg.id, msg.dlc, toUs(msg.length), toUs(msg.blocking));
+		if (msg.response >= 0)
+			std::printf("%10.1f ", toUs(msg.response));
+		else
+			std::printf("%10s ", "unbounded");
+		std::printf("%10.1f  %s\n", toUs(msg.deadline), pass ? "PASS" : "FAIL");
+	}
+
+	std::printf("\n%zu messages at %s, bus utilization %.1f %%, %zu missed deadlines\n",
+			set.size(), rate->name, utilization * 100.0, failed);
+
+	return (failed || (utilization >= 1.0)) ? 1 : 0;
+}